@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#
+#include <vector>
+#
+#include "Timer.hxx"
+#include "TimerItem.hxx"
+
+#define TARA_BENCHMARK_ITEM_COUNT 1000000
+
+namespace {
+
+void RunBenchmark(bool usesWheel, unsigned int itemCount);
+void Report(const char *backend, const char *phase, uint64_t startTime,
+            unsigned int operationCount);
+
+} // namespace
+
+int TaraMain(int argc, char **argv)
+{
+  unsigned int itemCount = argc >= 2 ? strtoul(argv[1], nullptr, 10) :
+                                       TARA_BENCHMARK_ITEM_COUNT;
+  if (itemCount == 0) {
+    fprintf(stderr, "usage: %s [item count]\n", argv[0]);
+    return 1;
+  }
+  printf("%u timers\n", itemCount);
+  RunBenchmark(false, itemCount);
+  RunBenchmark(true, itemCount);
+  return 0;
+}
+
+namespace {
+
+void RunBenchmark(bool usesWheel, unsigned int itemCount)
+{
+  const char *backend = usesWheel ? "wheel" : "heap";
+  Tara::Timer timer(usesWheel);
+  std::vector<Tara::TimerItem> items(itemCount);
+  std::vector<int> durations(itemCount);
+  srand(1);
+  for (int &duration : durations) {
+    duration = 1000 + rand() % 60000;
+  }
+  uint64_t startTime = Tara::Timer::GetNanosecondTime();
+  for (unsigned int i = 0; i < itemCount; ++i) {
+    timer.addItem(&items[i], durations[i]);
+  }
+  Report(backend, "addItem", startTime, itemCount);
+  startTime = Tara::Timer::GetNanosecondTime();
+  for (unsigned int i = 0; i < itemCount; ++i) {
+    timer.removeItem(&items[i]);
+    timer.addItem(&items[i], durations[itemCount - 1 - i]);
+  }
+  Report(backend, "removeItem + addItem", startTime, itemCount);
+  startTime = Tara::Timer::GetNanosecondTime();
+  for (unsigned int i = 0; i < itemCount; ++i) {
+    static_cast<void>(timer.calculateTimeout());
+  }
+  Report(backend, "calculateTimeout", startTime, itemCount);
+  startTime = Tara::Timer::GetNanosecondTime();
+  for (unsigned int i = 0; i < itemCount; ++i) {
+    timer.removeItem(&items[i]);
+  }
+  Report(backend, "removeItem", startTime, itemCount);
+  for (unsigned int i = 0; i < itemCount; ++i) {
+    timer.addItem(&items[i], i % 100);
+  }
+  timespec delay = {0, 110000000};
+  nanosleep(&delay, nullptr);
+  timer.updateTime();
+  startTime = Tara::Timer::GetNanosecondTime();
+  Tara::TimerItem *buffer[1024];
+  unsigned int dueItemCount = 0;
+  unsigned int n;
+  while ((n = timer.removeDueItems(buffer, 1024)) != 0) {
+    dueItemCount += n;
+  }
+  Report(backend, "removeDueItems", startTime, dueItemCount);
+}
+
+void Report(const char *backend, const char *phase, uint64_t startTime,
+            unsigned int operationCount)
+{
+  uint64_t duration = Tara::Timer::GetNanosecondTime() - startTime;
+  printf("%-6s %-22s %8.1f ns/op\n", backend, phase,
+         static_cast<double>(duration) / operationCount);
+}
+
+} // namespace
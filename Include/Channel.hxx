@@ -0,0 +1,132 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#
+#include <deque>
+#include <utility>
+
+namespace Tara {
+
+struct Fiber;
+class Scheduler;
+
+struct ChannelWaiter final
+{
+  void *queueItem[2];
+  Fiber *fiber;
+  void *value;
+  bool isDone;
+
+  explicit ChannelWaiter(void *value)
+    : fiber(nullptr), value(value), isDone(false)
+  {}
+};
+
+class ChannelBase
+{
+  ChannelBase(const ChannelBase &other) = delete;
+  void operator=(const ChannelBase &other) = delete;
+
+public:
+  bool isClosed() const { return isClosed_; }
+
+  void close();
+
+protected:
+  ChannelBase();
+  ~ChannelBase();
+
+  ChannelWaiter *popReceiver();
+  ChannelWaiter *popSender();
+  void awaitReceiver(ChannelWaiter *waiter);
+  void awaitSender(ChannelWaiter *waiter);
+
+  static void WakeWaiter(ChannelWaiter *waiter);
+
+private:
+  Scheduler *scheduler_;
+  bool isClosed_;
+  void *receiverQueue_[2];
+  void *senderQueue_[2];
+};
+
+template <typename TYPE>
+class Channel final : public ChannelBase
+{
+public:
+  explicit Channel(size_t capacity = SIZE_MAX) : capacity_(capacity) {}
+
+  size_t getCapacity() const { return capacity_; }
+  size_t getSize() const { return buffer_.size(); }
+
+  bool send(TYPE value)
+  {
+    if (trySend(&value)) {
+      return true;
+    }
+    if (isClosed()) {
+      return false;
+    }
+    ChannelWaiter waiter(&value);
+    awaitReceiver(&waiter);
+    return waiter.isDone;
+  }
+
+  bool trySend(TYPE *value)
+  {
+    if (isClosed()) {
+      return false;
+    }
+    ChannelWaiter *receiver = popReceiver();
+    if (receiver != nullptr) {
+      *static_cast<TYPE *>(receiver->value) = std::move(*value);
+      WakeWaiter(receiver);
+      return true;
+    }
+    if (buffer_.size() < capacity_) {
+      buffer_.push_back(std::move(*value));
+      return true;
+    }
+    return false;
+  }
+
+  bool receive(TYPE *value)
+  {
+    if (tryReceive(value)) {
+      return true;
+    }
+    if (isClosed()) {
+      return false;
+    }
+    ChannelWaiter waiter(value);
+    awaitSender(&waiter);
+    return waiter.isDone;
+  }
+
+  bool tryReceive(TYPE *value)
+  {
+    ChannelWaiter *sender = popSender();
+    if (buffer_.empty()) {
+      if (sender == nullptr) {
+        return false;
+      }
+      *value = std::move(*static_cast<TYPE *>(sender->value));
+    } else {
+      *value = std::move(buffer_.front());
+      buffer_.pop_front();
+      if (sender == nullptr) {
+        return true;
+      }
+      buffer_.push_back(std::move(*static_cast<TYPE *>(sender->value)));
+    }
+    WakeWaiter(sender);
+    return true;
+  }
+
+private:
+  const size_t capacity_;
+  std::deque<TYPE> buffer_;
+};
+
+} // namespace Tara
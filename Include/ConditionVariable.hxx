@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Mutex.hxx"
+
+namespace Tara {
+
+class Scheduler;
+
+class ConditionVariable final
+{
+  ConditionVariable(const ConditionVariable &other) = delete;
+  void operator=(const ConditionVariable &other) = delete;
+
+public:
+  ConditionVariable();
+  ~ConditionVariable();
+
+  int wait(Mutex *mutex, int timeout = -1);
+  void notifyOne();
+  void notifyAll();
+
+private:
+  Scheduler *scheduler_;
+  void *waiterQueue_[2];
+};
+
+} // namespace Tara
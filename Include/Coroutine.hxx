@@ -1,9 +1,61 @@
 #pragma once
 
+#include <stddef.h>
+#
 #include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace Tara {
 
 typedef std::function<void ()> Coroutine;
 
+struct CoroutineType final
+{
+  size_t size;
+  size_t alignment;
+  void (*construct)(void *coroutine, const void *argument);
+  void (*call)(void *coroutine);
+  void (*destroy)(void *coroutine);
+};
+
+template <typename ARGUMENT>
+class CoroutineTypeOf final
+{
+  typedef typename std::decay<ARGUMENT>::type Type;
+  typedef typename std::remove_reference<ARGUMENT>::type Argument;
+
+public:
+  static const CoroutineType Value;
+
+private:
+  static void Construct(void *coroutine, const void *argument)
+  {
+    new (coroutine) Type(std::forward<ARGUMENT>
+                         (*static_cast<Argument *>(const_cast<void *>
+                                                   (argument))));
+  }
+
+  static void Call(void *coroutine)
+  { (*static_cast<Type *>(coroutine))(); }
+
+  static void Destroy(void *coroutine)
+  { static_cast<Type *>(coroutine)->~Type(); }
+};
+
+template <typename ARGUMENT>
+const CoroutineType CoroutineTypeOf<ARGUMENT>::Value = {
+  sizeof(Type), alignof(Type), Construct, Call, Destroy
+};
+
+template <typename ARGUMENT>
+struct IsInlineCoroutine final
+  : std::integral_constant<bool,
+                           !std::is_same<typename std::decay<ARGUMENT>::type,
+                                         Coroutine>::value &&
+                           !std::is_function<typename std::remove_reference
+                                             <ARGUMENT>::type>::value>
+{};
+
 } // namespace Tara
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <stddef.h>
+#
+#include <new>
+#include <type_traits>
+#include <utility>
+#
+#include "Runtime.hxx"
+
+namespace Tara {
+
+struct Fiber;
+class JoinState;
+class Scheduler;
+
+struct JoinWaiter final
+{
+  Fiber *fiber;
+  JoinState *doneState;
+
+  JoinWaiter() : fiber(nullptr), doneState(nullptr) {}
+};
+
+class JoinState
+{
+  JoinState(const JoinState &other) = delete;
+  void operator=(const JoinState &other) = delete;
+
+public:
+  bool isDone() const { return isDone_; }
+  void setWaiter(JoinWaiter *waiter) { waiter_ = waiter; }
+
+  void retain() { ++referenceCount_; }
+  void release();
+  void wait();
+  void complete();
+
+protected:
+  JoinState();
+  virtual ~JoinState();
+
+  [[noreturn]] void reportMissingResult() const;
+
+private:
+  Scheduler *scheduler_;
+  unsigned int referenceCount_;
+  bool isDone_;
+  JoinWaiter *waiter_;
+};
+
+void AwaitJoin(JoinWaiter *waiter);
+
+template <typename TYPE>
+class JoinResult final : public JoinState
+{
+public:
+  JoinResult() : hasValue_(false) {}
+
+  ~JoinResult()
+  {
+    if (hasValue_) {
+      getValue()->~TYPE();
+    }
+  }
+
+  template <typename COROUTINE>
+  void run(COROUTINE &coroutine)
+  {
+    new (&value_) TYPE(coroutine());
+    hasValue_ = true;
+  }
+
+  TYPE take()
+  {
+    if (!hasValue_) {
+      reportMissingResult();
+    }
+    TYPE value(std::move(*getValue()));
+    getValue()->~TYPE();
+    hasValue_ = false;
+    return value;
+  }
+
+private:
+  typename std::aligned_storage<sizeof(TYPE), alignof(TYPE)>::type value_;
+  bool hasValue_;
+
+  TYPE *getValue() { return reinterpret_cast<TYPE *>(&value_); }
+};
+
+template <>
+class JoinResult<void> final : public JoinState
+{
+public:
+  JoinResult() : hasValue_(false) {}
+
+  template <typename COROUTINE>
+  void run(COROUTINE &coroutine)
+  {
+    coroutine();
+    hasValue_ = true;
+  }
+
+  void take()
+  {
+    if (!hasValue_) {
+      reportMissingResult();
+    }
+    hasValue_ = false;
+  }
+
+private:
+  bool hasValue_;
+};
+
+template <typename TYPE, typename COROUTINE>
+class SpawnedCoroutine final
+{
+  SpawnedCoroutine(const SpawnedCoroutine &other) = delete;
+  void operator=(const SpawnedCoroutine &other) = delete;
+
+public:
+  template <typename ARGUMENT>
+  SpawnedCoroutine(JoinResult<TYPE> *result, ARGUMENT &&coroutine)
+    : result_(result), coroutine_(std::forward<ARGUMENT>(coroutine))
+  {}
+
+  SpawnedCoroutine(SpawnedCoroutine &&other)
+    : result_(other.result_), coroutine_(std::move(other.coroutine_))
+  { other.result_ = nullptr; }
+
+  ~SpawnedCoroutine()
+  {
+    if (result_ != nullptr) {
+      result_->complete();
+      result_->release();
+    }
+  }
+
+  void operator()() { result_->run(coroutine_); }
+
+private:
+  JoinResult<TYPE> *result_;
+  COROUTINE coroutine_;
+};
+
+template <typename TYPE>
+class JoinHandle final
+{
+  JoinHandle(const JoinHandle &other) = delete;
+  void operator=(const JoinHandle &other) = delete;
+
+public:
+  JoinHandle() : result_(nullptr) {}
+  explicit JoinHandle(JoinResult<TYPE> *result) : result_(result) {}
+
+  JoinHandle(JoinHandle &&other)
+    : result_(other.result_)
+  { other.result_ = nullptr; }
+
+  JoinHandle &operator=(JoinHandle &&other)
+  {
+    std::swap(result_, other.result_);
+    return *this;
+  }
+
+  ~JoinHandle()
+  {
+    if (result_ != nullptr) {
+      result_->release();
+    }
+  }
+
+  bool isValid() const { return result_ != nullptr; }
+  bool isDone() const { return result_->isDone(); }
+  JoinState *getState() const { return result_; }
+
+  TYPE join()
+  {
+    result_->wait();
+    return result_->take();
+  }
+
+private:
+  JoinResult<TYPE> *result_;
+};
+
+template <typename COROUTINE>
+JoinHandle<typename std::result_of<typename std::decay<COROUTINE>::type &()>
+           ::type>
+Spawn(COROUTINE &&coroutine, size_t stackSize = 0)
+{
+  typedef typename std::decay<COROUTINE>::type Function;
+  typedef typename std::result_of<Function &()>::type Type;
+  auto result = new JoinResult<Type>();
+  result->retain();
+  Call(SpawnedCoroutine<Type, Function>(result,
+                                        std::forward<COROUTINE>(coroutine)),
+       stackSize);
+  return JoinHandle<Type>(result);
+}
+
+template <typename ITERATOR>
+ITERATOR WaitAny(ITERATOR first, ITERATOR last)
+{
+  for (ITERATOR i = first; i != last; ++i) {
+    if (i->isDone()) {
+      return i;
+    }
+  }
+  if (first == last) {
+    return last;
+  }
+  JoinWaiter waiter;
+  for (ITERATOR i = first; i != last; ++i) {
+    i->getState()->setWaiter(&waiter);
+  }
+  AwaitJoin(&waiter);
+  ITERATOR result = last;
+  for (ITERATOR i = first; i != last; ++i) {
+    i->getState()->setWaiter(nullptr);
+    if (i->getState() == waiter.doneState) {
+      result = i;
+    }
+  }
+  return result;
+}
+
+template <typename ITERATOR>
+void WaitAll(ITERATOR first, ITERATOR last)
+{
+  for (ITERATOR i = first; i != last; ++i) {
+    i->getState()->wait();
+  }
+}
+
+} // namespace Tara
@@ -0,0 +1,28 @@
+#pragma once
+
+namespace Tara {
+
+class Scheduler;
+
+class Mutex final
+{
+  Mutex(const Mutex &other) = delete;
+  void operator=(const Mutex &other) = delete;
+
+public:
+  Mutex();
+  ~Mutex();
+
+  bool isLocked() const { return isLocked_; }
+
+  void lock();
+  bool tryLock();
+  void unlock();
+
+private:
+  Scheduler *scheduler_;
+  bool isLocked_;
+  void *waiterQueue_[2];
+};
+
+} // namespace Tara
@@ -1,22 +1,67 @@
 #pragma once
 
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
 #
 #include "Coroutine.hxx"
 
 namespace Tara {
 
-void Call(const Coroutine &coroutine);
-void Call(Coroutine &&coroutine);
+struct FileIORequest final
+{
+  int fd;
+  void *buf;
+  size_t buflen;
+  off_t offset;
+  ssize_t result;
+};
+
+void CallCoroutine(const CoroutineType &coroutineType, const void *coroutine,
+                  size_t stackSize);
+void DispatchCoroutine(const CoroutineType &coroutineType,
+                       const void *coroutine, size_t stackSize);
+
+template <typename COROUTINE,
+          typename = typename std::enable_if<IsInlineCoroutine<COROUTINE>
+                                             ::value>::type>
+void Call(COROUTINE &&coroutine, size_t stackSize = 0)
+{ CallCoroutine(CoroutineTypeOf<COROUTINE>::Value, &coroutine, stackSize); }
+
+template <typename COROUTINE,
+          typename = typename std::enable_if<IsInlineCoroutine<COROUTINE>
+                                             ::value>::type>
+void Dispatch(COROUTINE &&coroutine, size_t stackSize = 0)
+{ DispatchCoroutine(CoroutineTypeOf<COROUTINE>::Value, &coroutine, stackSize); }
+
+// A dispatched fiber may start on any scheduler of the group. Mutex,
+// ConditionVariable, Semaphore, WaitGroup, Channel and JoinHandle belong to
+// the scheduler that first uses them and must not be shared across
+// schedulers.
+void Call(const Coroutine &coroutine, size_t stackSize = 0);
+void Call(Coroutine &&coroutine, size_t stackSize = 0);
+void Dispatch(const Coroutine &coroutine, size_t stackSize = 0);
+void Dispatch(Coroutine &&coroutine, size_t stackSize = 0);
 void Yield();
 void Sleep(int duration);
+// Only this overload has sub-millisecond resolution. Every other duration
+// and timeout, including those of the I/O calls, is in whole milliseconds.
+void Sleep(const timespec &duration);
+int GetTimerSlack();
+void SetTimerSlack(int timerSlack);
+void GetBusyPollCounters(unsigned long *spinHitCount,
+                         unsigned long *blockingWaitCount);
 [[noreturn]] void Exit();
 
 int Open(const char *path, int flags, mode_t mode = 0);
 int Pipe2(int *fds, int flags);
 int Socket(int domain, int type, int protocol);
 int Close(int fd);
+int Attach(int fd);
+int Detach(int fd);
 ssize_t Read(int fd, void *buf, size_t buflen, int timeout);
 ssize_t Write(int fd, const void *buf, size_t buflen, int timeout);
 int Accept4(int fd, sockaddr *addr, socklen_t *addrlen, int flags, int timeout);
@@ -27,10 +72,39 @@ ssize_t RecvFrom(int fd, void *buf, size_t buflen, int flags, sockaddr *addr,
                  socklen_t *addrlen, int timeout);
 ssize_t SendTo(int fd, const void *buf, size_t buflen, int flags,
                const sockaddr *addr, socklen_t addrlen, int timeout);
+ssize_t Readv(int fd, const iovec *iov, int iovcnt, int timeout);
+ssize_t Writev(int fd, const iovec *iov, int iovcnt, int timeout);
+ssize_t RecvMsg(int fd, msghdr *msg, int flags, int timeout);
+ssize_t SendMsg(int fd, const msghdr *msg, int flags, int timeout);
+int RecvMmsg(int fd, mmsghdr *msgvec, unsigned int vlen, int flags,
+             int timeout);
+int SendMmsg(int fd, mmsghdr *msgvec, unsigned int vlen, int flags,
+             int timeout);
+// SendZeroCopy returns once the data is queued. The kernel keeps reading
+// buf until a later WaitZeroCopySends(fd) returns.
+ssize_t SendZeroCopy(int fd, const void *buf, size_t buflen, int flags,
+                     int timeout);
+int WaitZeroCopySends(int fd, int timeout);
+ssize_t Sendfile(int outfd, int infd, off_t *offset, size_t count, int timeout);
+ssize_t Splice(int fdin, loff_t *offin, int fdout, loff_t *offout, size_t len,
+               unsigned int flags, int timeout);
+ssize_t Tee(int fdin, int fdout, size_t len, unsigned int flags, int timeout);
+int WaitAny(pollfd *fds, nfds_t nfds, int timeout);
 
 int OpenAsync(const char *path, int flags, mode_t mode = 0);
 int CloseAsync(int fd);
 ssize_t ReadAsync(int fd, void *buf, size_t buflen);
 ssize_t WriteAsync(int fd, const void *buf, size_t buflen);
+ssize_t PreadAsync(int fd, void *buf, size_t buflen, off_t offset);
+ssize_t PwriteAsync(int fd, const void *buf, size_t buflen, off_t offset);
+int FsyncAsync(int fd);
+int FdatasyncAsync(int fd);
+int StatAsync(const char *path, struct stat *buf);
+int FstatAsync(int fd, struct stat *buf);
+int FallocateAsync(int fd, int mode, off_t offset, off_t len);
+void PreadAsync(FileIORequest *requests, unsigned int requestCount);
+void PwriteAsync(FileIORequest *requests, unsigned int requestCount);
+int FsyncAsync(const int *fds, unsigned int fdCount);
+int FdatasyncAsync(const int *fds, unsigned int fdCount);
 
 } // namespace Tara
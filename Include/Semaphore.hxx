@@ -0,0 +1,28 @@
+#pragma once
+
+namespace Tara {
+
+class Scheduler;
+
+class Semaphore final
+{
+  Semaphore(const Semaphore &other) = delete;
+  void operator=(const Semaphore &other) = delete;
+
+public:
+  explicit Semaphore(unsigned int count = 0);
+  ~Semaphore();
+
+  unsigned int getCount() const { return count_; }
+
+  int wait(int timeout = -1);
+  bool tryWait();
+  void post(unsigned int count = 1);
+
+private:
+  Scheduler *scheduler_;
+  unsigned int count_;
+  void *waiterQueue_[2];
+};
+
+} // namespace Tara
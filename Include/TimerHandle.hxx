@@ -0,0 +1,51 @@
+#pragma once
+
+#include <utility>
+#
+#include "Coroutine.hxx"
+
+namespace Tara {
+
+struct CallbackTimer;
+
+class TimerHandle final
+{
+  TimerHandle(const TimerHandle &other) = delete;
+  void operator=(const TimerHandle &other) = delete;
+
+public:
+  TimerHandle() : timer_(nullptr) {}
+  explicit TimerHandle(CallbackTimer *timer) : timer_(timer) {}
+
+  TimerHandle(TimerHandle &&other)
+    : timer_(other.timer_)
+  { other.timer_ = nullptr; }
+
+  TimerHandle &operator=(TimerHandle &&other)
+  {
+    std::swap(timer_, other.timer_);
+    return *this;
+  }
+
+  ~TimerHandle();
+
+  bool isValid() const { return timer_ != nullptr; }
+  bool isActive() const;
+
+  void cancel();
+  // Lets the timer run on without the handle, as destruction does. A
+  // detached Every() no longer keeps the scheduler running.
+  void detach();
+
+private:
+  CallbackTimer *timer_;
+};
+
+// Callbacks run on the scheduler loop and must not block, unless usesFiber
+// asks for a fiber per run. Every() re-arms a fiber callback only after
+// the previous run returns, so runs never overlap. An active timer with a
+// handle, or an After() not yet fired, keeps the scheduler running.
+TimerHandle After(int delay, Coroutine callback, bool usesFiber = false);
+TimerHandle Every(int interval, Coroutine callback, bool usesFiber = false);
+
+} // namespace Tara
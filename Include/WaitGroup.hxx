@@ -0,0 +1,28 @@
+#pragma once
+
+namespace Tara {
+
+class Scheduler;
+
+class WaitGroup final
+{
+  WaitGroup(const WaitGroup &other) = delete;
+  void operator=(const WaitGroup &other) = delete;
+
+public:
+  WaitGroup();
+  ~WaitGroup();
+
+  unsigned int getCount() const { return count_; }
+
+  void add(unsigned int count = 1);
+  void done();
+  int wait(int timeout = -1);
+
+private:
+  Scheduler *scheduler_;
+  unsigned int count_;
+  void *waiterQueue_[2];
+};
+
+} // namespace Tara
@@ -6,13 +6,19 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdint.h>
+#include <time.h>
+#
+#include <algorithm>
 #
 #include "Error.hxx"
 #include "IOEvent.hxx"
 #include "Log.hxx"
 #include "Scheduler.hxx"
+#include "Timer.hxx"
 #include "Utility.hxx"
 
+#define TARA_ASYNC_THREAD_COUNT 4
+
 namespace Tara {
 
 namespace {
@@ -23,14 +29,19 @@ struct Job final
   Fiber *const fiber;
   const Task *const tasks;
   const unsigned int taskCount;
+  const uint64_t submissionTime;
 
   Job(Fiber *fiber, const Task *tasks, unsigned int taskCount);
 };
 
+unsigned int GetMaxThreadCount(unsigned int minThreadCount,
+                               unsigned int maxThreadCount);
+
 int xeventfd(unsigned int initval, int flags);
 size_t xwrite(int fd, const void *buf, size_t nbytes);
 size_t xread(int fd, void *buf, size_t nbytes);
 void xclose(int fd);
+void xclock_gettime(clockid_t clock_id, timespec *tp);
 void xthread_mutex_init(pthread_mutex_t *mutex,
                         const pthread_mutexattr_t *attr);
 void xthread_mutex_destroy(pthread_mutex_t *mutex);
@@ -39,6 +50,8 @@ void xthread_mutex_unlock(pthread_mutex_t *mutex);
 void xthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr);
 void xthread_cond_destroy(pthread_cond_t *cond);
 void xthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
+bool xthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                            const timespec *abstime);
 void xthread_cond_signal(pthread_cond_t *cond);
 void xthread_cond_broadcast(pthread_cond_t *cond);
 void xthread_create(pthread_t *thread, const pthread_attr_t *attr,
@@ -47,8 +60,13 @@ void xthread_join(pthread_t thread, void **retval);
 
 } // namespace
 
-Async::Async(Scheduler *scheduler)
-  : scheduler_(scheduler), fd_(xeventfd(0, 0)), workIsDone_(false), jobCount_(0)
+Async::Async(Scheduler *scheduler, unsigned int minThreadCount,
+             unsigned int maxThreadCount, int growthDelay, int idleTimeout)
+  : scheduler_(scheduler), fd_(xeventfd(0, 0)),
+    minThreadCount_(minThreadCount),
+    maxThreadCount_(GetMaxThreadCount(minThreadCount, maxThreadCount)),
+    growthDelay_(growthDelay), idleTimeout_(idleTimeout), workIsDone_(false),
+    jobCount_(0), pendingJobCount_(0), threadCount_(0), idleThreadCount_(0)
 {
   assert(scheduler_ != nullptr);
   QUEUE_INIT(&jobQueues_[0]);
@@ -56,9 +74,8 @@ Async::Async(Scheduler *scheduler)
   xthread_mutex_init(&mutexes_[0], nullptr);
   xthread_mutex_init(&mutexes_[1], nullptr);
   xthread_cond_init(&condition_, nullptr);
-  for (int i = 0; i < TARA_LENGTH_OF(threads_); ++i) {
-    xthread_create(&threads_[i], nullptr,
-                   reinterpret_cast<void *(*)(void *)>(Worker), this);
+  while (threadCount_ < minThreadCount_) {
+    addThread();
   }
 }
 
@@ -68,8 +85,8 @@ Async::~Async()
   workIsDone_ = true;
   xthread_mutex_unlock(&mutexes_[0]);
   xthread_cond_broadcast(&condition_);
-  for (int i = 0; i < TARA_LENGTH_OF(threads_); ++i) {
-    xthread_join(threads_[i], nullptr);
+  for (pthread_t thread : threads_) {
+    xthread_join(thread, nullptr);
   }
   xthread_mutex_destroy(&mutexes_[0]);
   xthread_mutex_destroy(&mutexes_[1]);
@@ -79,17 +96,46 @@ Async::~Async()
 
 void Async::doWork()
 {
+  xthread_mutex_lock(&mutexes_[0]);
   for (;;) {
-    xthread_mutex_lock(&mutexes_[0]);
-    while (!workIsDone_ && QUEUE_EMPTY(&jobQueues_[0])) {
-      xthread_cond_wait(&condition_, &mutexes_[0]);
+    timespec deadline;
+    if (idleTimeout_ > 0) {
+      xclock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_sec += idleTimeout_ / 1000;
+      deadline.tv_nsec += idleTimeout_ % 1000 * 1000000;
+      if (deadline.tv_nsec >= 1000000000) {
+        ++deadline.tv_sec;
+        deadline.tv_nsec -= 1000000000;
+      }
+    }
+    bool isTimedOut = false;
+    while (!workIsDone_ && QUEUE_EMPTY(&jobQueues_[0]) && !isTimedOut) {
+      if (idleTimeout_ > 0) {
+        isTimedOut = !xthread_cond_timedwait(&condition_, &mutexes_[0],
+                                             &deadline);
+      } else {
+        xthread_cond_wait(&condition_, &mutexes_[0]);
+      }
     }
     if (workIsDone_) {
-      xthread_mutex_unlock(&mutexes_[0]);
       break;
     }
+    if (QUEUE_EMPTY(&jobQueues_[0])) {
+      if (threadCount_ > minThreadCount_) {
+        --threadCount_;
+        --idleThreadCount_;
+        retiredThreads_.push_back(pthread_self());
+        break;
+      }
+      continue;
+    }
     auto job = QUEUE_DATA(QUEUE_HEAD(&jobQueues_[0]), Job, queueItem);
     QUEUE_REMOVE(&job->queueItem);
+    --pendingJobCount_;
+    --idleThreadCount_;
+    if (needsThread()) {
+      addThread();
+    }
     xthread_mutex_unlock(&mutexes_[0]);
     for (int i = 0; i < job->taskCount; ++i) {
       job->tasks[i]();
@@ -99,7 +145,10 @@ void Async::doWork()
     uint64_t value = 1;
     static_cast<void>(xwrite(fd_, &value, sizeof value));
     xthread_mutex_unlock(&mutexes_[1]);
+    xthread_mutex_lock(&mutexes_[0]);
+    ++idleThreadCount_;
   }
+  xthread_mutex_unlock(&mutexes_[0]);
 }
 
 void Async::awaitTasks(const Task *tasks, unsigned int taskCount)
@@ -107,14 +156,27 @@ void Async::awaitTasks(const Task *tasks, unsigned int taskCount)
   Job job(scheduler_->getCurrentFiber(), tasks, taskCount);
   xthread_mutex_lock(&mutexes_[0]);
   QUEUE_INSERT_TAIL(&jobQueues_[0], &job.queueItem);
+  ++pendingJobCount_;
+  if (needsThread()) {
+    addThread();
+  }
   xthread_cond_signal(&condition_);
   xthread_mutex_unlock(&mutexes_[0]);
+  joinRetiredThreads();
   ++jobCount_;
   if (jobCount_ == 1) {
     scheduler_->callCoroutine([this] {
       scheduler_->watchIO(fd_);
       do {
-        scheduler_->awaitIOEvent(fd_, IOEvent::Readability, -1);
+        int timeout = growthDelay_ == 0 ? -1 : growthDelay_;
+        if (scheduler_->awaitIOEvent(fd_, IOEvent::Readability, timeout) < 0) {
+          xthread_mutex_lock(&mutexes_[0]);
+          if (needsThread()) {
+            addThread();
+          }
+          xthread_mutex_unlock(&mutexes_[0]);
+          continue;
+        }
         xthread_mutex_lock(&mutexes_[1]);
         uint64_t value;
         static_cast<void>(xread(fd_, &value, sizeof value));
@@ -134,15 +196,74 @@ void Async::awaitTasks(const Task *tasks, unsigned int taskCount)
   scheduler_->suspendCurrentFiber();
 }
 
+bool Async::needsThread() const
+{
+  if (workIsDone_ || pendingJobCount_ <= idleThreadCount_ ||
+      threadCount_ >= maxThreadCount_) {
+    return false;
+  }
+  if (threadCount_ == 0 || growthDelay_ == 0) {
+    return true;
+  }
+  auto job = QUEUE_DATA(QUEUE_HEAD(&jobQueues_[0]), Job, queueItem);
+  return Timer::GetTime() - job->submissionTime >= growthDelay_;
+}
+
+void Async::addThread()
+{
+  pthread_t thread;
+  xthread_create(&thread, nullptr, Worker, this);
+  threads_.push_back(thread);
+  ++threadCount_;
+  ++idleThreadCount_;
+}
+
+void *Async::Worker(void *async)
+{
+  assert(async != nullptr);
+  static_cast<Async *>(async)->doWork();
+  return nullptr;
+}
+
+void Async::joinRetiredThreads()
+{
+  std::vector<pthread_t> retiredThreads;
+  xthread_mutex_lock(&mutexes_[0]);
+  if (retiredThreads_.empty()) {
+    xthread_mutex_unlock(&mutexes_[0]);
+    return;
+  }
+  retiredThreads.swap(retiredThreads_);
+  for (pthread_t thread : retiredThreads) {
+    threads_.erase(std::find(threads_.begin(), threads_.end(), thread));
+  }
+  xthread_mutex_unlock(&mutexes_[0]);
+  for (pthread_t thread : retiredThreads) {
+    xthread_join(thread, nullptr);
+  }
+}
+
 namespace {
 
 Job::Job(Fiber *fiber, const Task *tasks, unsigned int taskCount)
-  : fiber(fiber), tasks(tasks), taskCount(taskCount)
+  : fiber(fiber), tasks(tasks), taskCount(taskCount),
+    submissionTime(Timer::GetTime())
 {
   assert(this->fiber != nullptr);
   assert(this->taskCount == 0 || this->tasks != nullptr);
 }
 
+unsigned int GetMaxThreadCount(unsigned int minThreadCount,
+                               unsigned int maxThreadCount)
+{
+  if (maxThreadCount == 0) {
+    long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    maxThreadCount = processorCount > TARA_ASYNC_THREAD_COUNT ?
+                     processorCount : TARA_ASYNC_THREAD_COUNT;
+  }
+  return std::max(maxThreadCount, minThreadCount);
+}
+
 int xeventfd(unsigned int initval, int flags)
 {
   int fd = eventfd(initval, flags);
@@ -196,6 +317,13 @@ void xclose(int fd)
   }
 }
 
+void xclock_gettime(clockid_t clock_id, timespec *tp)
+{
+  if (clock_gettime(clock_id, tp) < 0) {
+    TARA_FATALITY_LOG("clock_gettime failed: ", Error(errno));
+  }
+}
+
 void xthread_mutex_init(pthread_mutex_t *mutex,
                         const pthread_mutexattr_t *attr)
 {
@@ -271,6 +399,19 @@ void xthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
   }
 }
 
+bool xthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                            const timespec *abstime)
+{
+  int errorNumber = pthread_cond_timedwait(cond, mutex, abstime);
+  if (errorNumber == ETIMEDOUT) {
+    return false;
+  }
+  if (errorNumber != 0) {
+    TARA_FATALITY_LOG("pthread_cond_timedwait failed: ", Error(errorNumber));
+  }
+  return true;
+}
+
 void xthread_cond_signal(pthread_cond_t *cond)
 {
   int errorNumber = pthread_cond_signal(cond);
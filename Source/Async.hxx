@@ -3,6 +3,7 @@
 #include <pthread.h>
 #
 #include <functional>
+#include <vector>
 #
 #include "libuv/queue.h"
 
@@ -18,7 +19,8 @@ class Async final
   void operator=(const Async &other) = delete;
 
 public:
-  explicit Async(Scheduler *scheduler);
+  Async(Scheduler *scheduler, unsigned int minThreadCount,
+        unsigned int maxThreadCount, int growthDelay, int idleTimeout);
   ~Async();
 
   void awaitTask(const Task *task) { awaitTasks(task, 1); }
@@ -26,18 +28,29 @@ public:
   void awaitTasks(const Task *tasks, unsigned int taskCount);
 
 private:
-  static void Worker(Async *async) { async->doWork(); }
+  static void *Worker(void *async);
 
   Scheduler *const scheduler_;
   const int fd_;
+  const unsigned int minThreadCount_;
+  const unsigned int maxThreadCount_;
+  const int growthDelay_;
+  const int idleTimeout_;
   bool workIsDone_;
   unsigned int jobCount_;
+  unsigned int pendingJobCount_;
+  unsigned int threadCount_;
+  unsigned int idleThreadCount_;
   QUEUE jobQueues_[2];
   pthread_mutex_t mutexes_[2];
   pthread_cond_t condition_;
-  pthread_t threads_[4];
+  std::vector<pthread_t> threads_;
+  std::vector<pthread_t> retiredThreads_;
 
   void doWork();
+  bool needsThread() const;
+  void addThread();
+  void joinRetiredThreads();
 };
 
 } // namespace Tara
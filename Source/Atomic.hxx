@@ -4,6 +4,23 @@ namespace Tara {
 
 #if defined __i386__ || defined __x86_64__
 
+template<typename TYPE>
+inline TYPE Load(const TYPE &lvalue)
+{
+  TYPE value = *static_cast<const volatile TYPE *>(&lvalue);
+  __asm__ __volatile__ ("" : : : "memory");
+  // value <- lvalue (acquire)
+  return value;
+}
+
+template<typename TYPE>
+inline void Store(TYPE &lvalue, const TYPE &rvalue)
+{
+  __asm__ __volatile__ ("" : : : "memory");
+  *static_cast<volatile TYPE *>(&lvalue) = rvalue;
+  // lvalue <- rvalue (release)
+}
+
 template<typename TYPE>
 inline void Exchange(TYPE &lvalue1, TYPE &lvalue2)
 {
@@ -0,0 +1,108 @@
+#include "Channel.hxx"
+
+#include <assert.h>
+#
+#include "libuv/queue.h"
+#
+#include "TheScheduler.hxx"
+
+namespace Tara {
+
+namespace {
+
+ChannelWaiter *PopWaiter(QUEUE *waiterQueue);
+void AwaitWaiter(QUEUE *waiterQueue, ChannelWaiter *waiter);
+void CancelWaiters(QUEUE *waiterQueue);
+
+} // namespace
+
+ChannelBase::ChannelBase()
+  : scheduler_(nullptr), isClosed_(false)
+{
+  QUEUE_INIT(&receiverQueue_);
+  QUEUE_INIT(&senderQueue_);
+}
+
+ChannelBase::~ChannelBase()
+{
+  assert(QUEUE_EMPTY(&receiverQueue_));
+  assert(QUEUE_EMPTY(&senderQueue_));
+}
+
+void ChannelBase::close()
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (isClosed_) {
+    return;
+  }
+  isClosed_ = true;
+  CancelWaiters(&receiverQueue_);
+  CancelWaiters(&senderQueue_);
+}
+
+ChannelWaiter *ChannelBase::popReceiver()
+{
+  CHECK_THE_OWNER(scheduler_);
+  return PopWaiter(&receiverQueue_);
+}
+
+ChannelWaiter *ChannelBase::popSender()
+{
+  CHECK_THE_OWNER(scheduler_);
+  return PopWaiter(&senderQueue_);
+}
+
+void ChannelBase::awaitReceiver(ChannelWaiter *waiter)
+{
+  assert(!isClosed_);
+  CHECK_THE_OWNER(scheduler_);
+  AwaitWaiter(&senderQueue_, waiter);
+}
+
+void ChannelBase::awaitSender(ChannelWaiter *waiter)
+{
+  assert(!isClosed_);
+  CHECK_THE_OWNER(scheduler_);
+  AwaitWaiter(&receiverQueue_, waiter);
+}
+
+void ChannelBase::WakeWaiter(ChannelWaiter *waiter)
+{
+  assert(waiter != nullptr);
+  CHECK_THE_SCHEDULER;
+  waiter->isDone = true;
+  TheScheduler->resumeFiber(waiter->fiber);
+}
+
+namespace {
+
+ChannelWaiter *PopWaiter(QUEUE *waiterQueue)
+{
+  if (QUEUE_EMPTY(waiterQueue)) {
+    return nullptr;
+  }
+  QUEUE *queueItem = QUEUE_HEAD(waiterQueue);
+  QUEUE_REMOVE(queueItem);
+  return QUEUE_DATA(queueItem, ChannelWaiter, queueItem);
+}
+
+void AwaitWaiter(QUEUE *waiterQueue, ChannelWaiter *waiter)
+{
+  assert(waiter != nullptr);
+  CHECK_THE_SCHEDULER;
+  waiter->fiber = TheScheduler->getCurrentFiber();
+  QUEUE_INSERT_TAIL(waiterQueue, &waiter->queueItem);
+  TheScheduler->suspendCurrentFiber();
+}
+
+void CancelWaiters(QUEUE *waiterQueue)
+{
+  while (!QUEUE_EMPTY(waiterQueue)) {
+    ChannelWaiter *waiter = PopWaiter(waiterQueue);
+    TheScheduler->resumeFiber(waiter->fiber);
+  }
+}
+
+} // namespace
+
+} // namespace Tara
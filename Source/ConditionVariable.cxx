@@ -0,0 +1,54 @@
+#include "ConditionVariable.hxx"
+
+#include <assert.h>
+#include <errno.h>
+#
+#include "libuv/queue.h"
+#
+#include "TheScheduler.hxx"
+
+namespace Tara {
+
+ConditionVariable::ConditionVariable()
+  : scheduler_(nullptr)
+{
+  QUEUE_INIT(&waiterQueue_);
+}
+
+ConditionVariable::~ConditionVariable()
+{
+  assert(QUEUE_EMPTY(&waiterQueue_));
+}
+
+int ConditionVariable::wait(Mutex *mutex, int timeout)
+{
+  assert(mutex != nullptr);
+  assert(mutex->isLocked());
+  CHECK_THE_OWNER(scheduler_);
+  mutex->unlock();
+  int result = TheScheduler->suspendCurrentFiber(&waiterQueue_, timeout);
+  int errorNumber = errno;
+  mutex->lock();
+  errno = errorNumber;
+  return result;
+}
+
+void ConditionVariable::notifyOne()
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (QUEUE_EMPTY(&waiterQueue_)) {
+    return;
+  }
+  TheScheduler->resumeFiber(&waiterQueue_);
+}
+
+void ConditionVariable::notifyAll()
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (QUEUE_EMPTY(&waiterQueue_)) {
+    return;
+  }
+  while (TheScheduler->resumeFiber(&waiterQueue_)) {}
+}
+
+} // namespace Tara
@@ -5,7 +5,8 @@ namespace Tara {
 enum class IOEvent
 {
   Readability,
-  Writability
+  Writability,
+  Error
 };
 
 } // namespace Tara
@@ -1,10 +1,16 @@
 #include "IOPoll.hxx"
 
+#include <linux/errqueue.h>
+#include <netinet/in.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #
 #include <assert.h>
 #include <errno.h>
+#include <stdint.h>
 #
 #include "Error.hxx"
 #include "IOEvent.hxx"
@@ -17,55 +23,113 @@ struct IOWatcher final
 {
   QUEUE queueItem;
   const int fd;
+  const bool isFile;
   uint32_t eventFlags;
   uint32_t pendingEventFlags;
-  QUEUE eventAwaiterQueues[2];
+  uint32_t readyEventFlags;
+  bool zeroCopyIsEnabled;
+  uint32_t zeroCopySendCount;
+  uint32_t zeroCopyCompletionCount;
+  QUEUE eventAwaiterQueues[3];
+  QUEUE requestQueue;
 
-  explicit IOWatcher(int fd);
+  IOWatcher(int fd, bool isFile);
 };
 
 namespace {
 
 const uint32_t IOEventFlags[] = {
   [static_cast<int>(IOEvent::Readability)] = EPOLLIN,
-  [static_cast<int>(IOEvent::Writability)] = EPOLLOUT
+  [static_cast<int>(IOEvent::Writability)] = EPOLLOUT,
+  [static_cast<int>(IOEvent::Error)] = EPOLLERR
 };
 
 uint32_t NextPowerOfTwo(uint32_t number);
+void WakeEventAwaiters(QUEUE *eventAwaiterQueue1, QUEUE *eventAwaiterQueue2);
+int EpollPwait2(int epfd, epoll_event *events, int maxevents,
+                const timespec *timeout, int fallbackTimeout);
 
 int xepoll_create1(int flags);
 void xepoll_ctl(int epfd, int op, int fd, epoll_event *event);
+int xeventfd(unsigned int initval, int flags);
 void xclose(int fd);
 
 } // namespace
 
-IOPoll::IOPoll()
-  : fd_(xepoll_create1(0)), watcherMemoryPool_(sizeof(IOWatcher), 1024)
+IOPoll::IOPoll(bool usesEdgeTrigger)
+  : fd_(xepoll_create1(0)), interruptionFd_(xeventfd(0, EFD_NONBLOCK)),
+    usesEdgeTrigger_(usesEdgeTrigger),
+    watcherMemoryPool_(sizeof(IOWatcher), 1024)
 {
   QUEUE_INIT(&dirtyWatcherQueue_);
+  epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  xepoll_ctl(fd_, EPOLL_CTL_ADD, interruptionFd_, &event);
 }
 
 IOPoll::~IOPoll()
 {
+  xclose(interruptionFd_);
   xclose(fd_);
 }
 
-void IOPoll::createWatcher(int fd)
+void IOPoll::interrupt()
+{
+  uint64_t value = 1;
+  while (write(interruptionFd_, &value, sizeof value) < 0 && errno == EINTR);
+}
+
+void IOPoll::createWatcher(int fd, bool isFile)
 {
   assert(fd >= 0);
   if (fd >= watchers_.size()) {
     watchers_.resize(NextPowerOfTwo(fd + 1), nullptr);
   }
   assert(watchers_[fd] == nullptr);
-  auto watcher = new (watcherMemoryPool_.allocateBlock()) IOWatcher(fd);
+  void *block = watcherMemoryPool_.allocateBlock();
+  auto watcher = new (block) IOWatcher(fd, isFile);
   QUEUE_INIT(&watcher->queueItem);
   watchers_[fd] = watcher;
+  if (!usesEdgeTrigger_ || isFile) {
+    return;
+  }
+  epoll_event event;
+  event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+  event.data.ptr = watcher;
+  if (epoll_ctl(fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+    if (errno != EPERM) {
+      TARA_FATALITY_LOG("epoll_ctl failed: ", Error(errno));
+    }
+    return;
+  }
+  watcher->eventFlags = event.events;
+}
+
+bool IOPoll::watcherIsFile(int fd) const
+{
+  assert(watcherExists(fd));
+  return watchers_[fd]->isFile;
+}
+
+bool IOPoll::watcherIsPollable(int fd) const
+{
+  assert(watcherExists(fd));
+  return !usesEdgeTrigger_ || watchers_[fd]->eventFlags != 0;
+}
+
+bool IOPoll::eventIsReady(int fd, IOEvent event) const
+{
+  assert(watcherExists(fd));
+  return (watchers_[fd]->readyEventFlags &
+          IOEventFlags[static_cast<int>(event)]) != 0;
 }
 
 void IOPoll::destroyWatcher(int fd)
 {
   assert(watcherExists(fd));
   IOWatcher *watcher = watchers_[fd];
+  assert(QUEUE_EMPTY(&watcher->requestQueue));
   watchers_[fd] = nullptr;
   if (!QUEUE_EMPTY(&watcher->queueItem)) {
     QUEUE_REMOVE(&watcher->queueItem);
@@ -87,6 +151,12 @@ void IOPoll::addEventAwaiter(QUEUE *eventAwaiterQueueItem, int fd,
                                        [static_cast<int>(event)];
   QUEUE_INSERT_TAIL(eventAwaiterQueue, eventAwaiterQueueItem);
   uint32_t eventFlag = IOEventFlags[static_cast<int>(event)];
+  if (usesEdgeTrigger_) {
+    if (watcher->eventFlags != 0) {
+      watcher->readyEventFlags &= ~eventFlag;
+    }
+    return;
+  }
   if ((watcher->pendingEventFlags & eventFlag) == 0) {
     watcher->pendingEventFlags |= eventFlag;
     if (QUEUE_EMPTY(&watcher->queueItem)) {
@@ -100,6 +170,9 @@ void IOPoll::removeEventAwaiter(const QUEUE &eventAwaiterQueueItem, int fd)
   assert(watcherExists(fd));
   IOWatcher *watcher = watchers_[fd];
   QUEUE_REMOVE(&eventAwaiterQueueItem);
+  if (usesEdgeTrigger_) {
+    return;
+  }
   if (QUEUE_NEXT(&eventAwaiterQueueItem) ==
       QUEUE_PREV(&eventAwaiterQueueItem)) {
     uint32_t eventFlag = IOEventFlags[QUEUE_NEXT(&eventAwaiterQueueItem) -
@@ -116,16 +189,14 @@ void IOPoll::removeEventAwaiters(int fd, QUEUE *eventAwaiterQueue)
   assert(watcherExists(fd));
   assert(eventAwaiterQueue != nullptr);
   IOWatcher *watcher = watchers_[fd];
-  if (watcher->pendingEventFlags == 0) {
+  if (!usesEdgeTrigger_ && watcher->pendingEventFlags == 0) {
     return;
   }
-  if (!QUEUE_EMPTY(&watcher->eventAwaiterQueues[0])) {
-    QUEUE_ADD(eventAwaiterQueue, &watcher->eventAwaiterQueues[0]);
-    QUEUE_INIT(&watcher->eventAwaiterQueues[0]);
-  }
-  if (!QUEUE_EMPTY(&watcher->eventAwaiterQueues[1])) {
-    QUEUE_ADD(eventAwaiterQueue, &watcher->eventAwaiterQueues[1]);
-    QUEUE_INIT(&watcher->eventAwaiterQueues[1]);
+  WakeEventAwaiters(&watcher->eventAwaiterQueues[0], eventAwaiterQueue);
+  WakeEventAwaiters(&watcher->eventAwaiterQueues[1], eventAwaiterQueue);
+  WakeEventAwaiters(&watcher->eventAwaiterQueues[2], eventAwaiterQueue);
+  if (usesEdgeTrigger_) {
+    return;
   }
   watcher->pendingEventFlags = 0;
   if (QUEUE_EMPTY(&watcher->queueItem)) {
@@ -133,38 +204,117 @@ void IOPoll::removeEventAwaiters(int fd, QUEUE *eventAwaiterQueue)
   }
 }
 
-bool IOPoll::waitForEvents(int timeout, QUEUE *eventAwaiterQueue)
+void IOPoll::addRequest(QUEUE *requestQueueItem, int fd)
 {
-  assert(eventAwaiterQueue != nullptr);
-  if (!QUEUE_EMPTY(&dirtyWatcherQueue_)) {
-    QUEUE *q = QUEUE_HEAD(&dirtyWatcherQueue_);
-    do {
-      auto watcher = QUEUE_DATA(q, IOWatcher, queueItem);
-      q = QUEUE_NEXT(q);
-      QUEUE_INIT(&watcher->queueItem);
-      if (watcher->eventFlags == watcher->pendingEventFlags) {
+  assert(requestQueueItem != nullptr);
+  assert(watcherExists(fd));
+  QUEUE_INSERT_TAIL(&watchers_[fd]->requestQueue, requestQueueItem);
+}
+
+const QUEUE *IOPoll::getRequestQueue(int fd) const
+{
+  assert(watcherExists(fd));
+  return &watchers_[fd]->requestQueue;
+}
+
+bool IOPoll::enableZeroCopy(int fd)
+{
+  assert(watcherExists(fd));
+  IOWatcher *watcher = watchers_[fd];
+  if (!watcher->zeroCopyIsEnabled) {
+    int optval = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof optval) < 0) {
+      return false;
+    }
+    watcher->zeroCopyIsEnabled = true;
+  }
+  return true;
+}
+
+void IOPoll::addZeroCopySend(int fd)
+{
+  assert(watcherExists(fd));
+  IOWatcher *watcher = watchers_[fd];
+  assert(watcher->zeroCopyIsEnabled);
+  ++watcher->zeroCopySendCount;
+}
+
+int IOPoll::reapZeroCopyCompletions(int fd)
+{
+  assert(watcherExists(fd));
+  IOWatcher *watcher = watchers_[fd];
+  while (watcher->zeroCopyCompletionCount != watcher->zeroCopySendCount) {
+    unsigned char control[128];
+    msghdr message = {};
+    message.msg_control = control;
+    message.msg_controllen = sizeof control;
+    if (recvmsg(fd, &message, MSG_ERRQUEUE) < 0) {
+      if (errno == EINTR) {
         continue;
       }
-      int op;
-      if (watcher->eventFlags == 0) {
-        op = EPOLL_CTL_ADD;
-      } else {
-        if (watcher->pendingEventFlags == 0) {
-          op = EPOLL_CTL_DEL;
-        } else {
-          op = EPOLL_CTL_MOD;
-        }
+      return -1;
+    }
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&message, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+        continue;
+      }
+      auto error = reinterpret_cast<const sock_extended_err *>
+                   (CMSG_DATA(cmsg));
+      if (error->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+        watcher->zeroCopyCompletionCount += error->ee_data - error->ee_info + 1;
       }
-      epoll_event event;
-      event.events = watcher->pendingEventFlags;
-      event.data.ptr = watcher;
-      xepoll_ctl(fd_, op, watcher->fd, &event);
-      watcher->eventFlags = watcher->pendingEventFlags;
-    } while (q != &dirtyWatcherQueue_);
-    QUEUE_INIT(&dirtyWatcherQueue_);
+    }
+  }
+  return 0;
+}
+
+void IOPoll::updateWatchers()
+{
+  if (QUEUE_EMPTY(&dirtyWatcherQueue_)) {
+    return;
   }
+  QUEUE *q = QUEUE_HEAD(&dirtyWatcherQueue_);
+  do {
+    auto watcher = QUEUE_DATA(q, IOWatcher, queueItem);
+    q = QUEUE_NEXT(q);
+    QUEUE_INIT(&watcher->queueItem);
+    if (watcher->eventFlags == watcher->pendingEventFlags) {
+      continue;
+    }
+    int op;
+    if (watcher->eventFlags == 0) {
+      op = EPOLL_CTL_ADD;
+    } else {
+      if (watcher->pendingEventFlags == 0) {
+        op = EPOLL_CTL_DEL;
+      } else {
+        op = EPOLL_CTL_MOD;
+      }
+    }
+    epoll_event event;
+    event.events = watcher->pendingEventFlags;
+    event.data.ptr = watcher;
+    xepoll_ctl(fd_, op, watcher->fd, &event);
+    watcher->eventFlags = watcher->pendingEventFlags;
+  } while (q != &dirtyWatcherQueue_);
+  QUEUE_INIT(&dirtyWatcherQueue_);
+}
+
+bool IOPoll::waitForEvents(int timeout, QUEUE *eventAwaiterQueue,
+                           const timespec *preciseTimeout)
+{
+  assert(eventAwaiterQueue != nullptr);
+  updateWatchers();
   epoll_event events[1024];
-  int n = epoll_wait(fd_, events, TARA_LENGTH_OF(events), timeout);
+  int n;
+  if (preciseTimeout == nullptr) {
+    n = epoll_wait(fd_, events, TARA_LENGTH_OF(events), timeout);
+  } else {
+    n = EpollPwait2(fd_, events, TARA_LENGTH_OF(events), preciseTimeout,
+                    timeout);
+  }
   if (n < 0) {
     if (errno == EINTR) {
       return false;
@@ -174,10 +324,30 @@ bool IOPoll::waitForEvents(int timeout, QUEUE *eventAwaiterQueue)
   for (int i = 0; i < n; ++i) {
     const epoll_event &event = events[i];
     auto watcher = static_cast<IOWatcher *>(event.data.ptr);
+    if (watcher == nullptr) {
+      uint64_t value;
+      while (read(interruptionFd_, &value, sizeof value) < 0 &&
+             errno == EINTR);
+      continue;
+    }
     if ((event.events & (EPOLLERR | EPOLLHUP)) != 0) {
+      if (watcher->zeroCopySendCount != watcher->zeroCopyCompletionCount) {
+        static_cast<void>(reapZeroCopyCompletions(watcher->fd));
+      }
+      watcher->readyEventFlags = EPOLLIN | EPOLLOUT;
       removeEventAwaiters(watcher->fd, eventAwaiterQueue);
       continue;
     }
+    if (usesEdgeTrigger_) {
+      for (int j = 0; j < 2; ++j) {
+        if ((event.events & IOEventFlags[j]) != 0) {
+          watcher->readyEventFlags |= IOEventFlags[j];
+          WakeEventAwaiters(&watcher->eventAwaiterQueues[j],
+                            eventAwaiterQueue);
+        }
+      }
+      continue;
+    }
     if ((event.events & IOEventFlags[0]) != 0) {
       QUEUE *q = QUEUE_HEAD(&watcher->eventAwaiterQueues[0]);
       removeEventAwaiter(*q, watcher->fd);
@@ -192,11 +362,15 @@ bool IOPoll::waitForEvents(int timeout, QUEUE *eventAwaiterQueue)
   return true;
 }
 
-IOWatcher::IOWatcher(int fd)
-  : fd(fd), eventFlags(0), pendingEventFlags(0)
+IOWatcher::IOWatcher(int fd, bool isFile)
+  : fd(fd), isFile(isFile), eventFlags(0), pendingEventFlags(0),
+    readyEventFlags(EPOLLIN | EPOLLOUT), zeroCopyIsEnabled(false),
+    zeroCopySendCount(0), zeroCopyCompletionCount(0)
 {
   QUEUE_INIT(&this->eventAwaiterQueues[0]);
   QUEUE_INIT(&this->eventAwaiterQueues[1]);
+  QUEUE_INIT(&this->eventAwaiterQueues[2]);
+  QUEUE_INIT(&this->requestQueue);
 }
 
 namespace {
@@ -213,6 +387,35 @@ uint32_t NextPowerOfTwo(uint32_t number)
   return number;
 }
 
+void WakeEventAwaiters(QUEUE *eventAwaiterQueue1, QUEUE *eventAwaiterQueue2)
+{
+  assert(eventAwaiterQueue1 != nullptr);
+  assert(eventAwaiterQueue2 != nullptr);
+  if (!QUEUE_EMPTY(eventAwaiterQueue1)) {
+    QUEUE_ADD(eventAwaiterQueue2, eventAwaiterQueue1);
+    QUEUE_INIT(eventAwaiterQueue1);
+  }
+}
+
+int EpollPwait2(int epfd, epoll_event *events, int maxevents,
+                const timespec *timeout, int fallbackTimeout)
+{
+#ifdef SYS_epoll_pwait2
+  static thread_local bool isSupported = true;
+  if (isSupported) {
+    int n = syscall(SYS_epoll_pwait2, epfd, events, maxevents, timeout,
+                    nullptr, 0);
+    if (n >= 0 || errno != ENOSYS) {
+      return n;
+    }
+    isSupported = false;
+  }
+#else
+  static_cast<void>(timeout);
+#endif
+  return epoll_wait(epfd, events, maxevents, fallbackTimeout);
+}
+
 int xepoll_create1(int flags)
 {
   int fd = epoll_create1(flags);
@@ -229,6 +432,15 @@ void xepoll_ctl(int epfd, int op, int fd, epoll_event *event)
   }
 }
 
+int xeventfd(unsigned int initval, int flags)
+{
+  int fd = eventfd(initval, flags);
+  if (fd < 0) {
+    TARA_FATALITY_LOG("eventfd failed: ", Error(errno));
+  }
+  return fd;
+}
+
 void xclose(int fd)
 {
   int result;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <time.h>
+#
 #include <vector>
 #
 #include "libuv/queue.h"
@@ -17,21 +19,36 @@ class IOPoll final
   void operator=(const IOPoll &other) = delete;
 
 public:
-  IOPoll();
+  explicit IOPoll(bool usesEdgeTrigger = false);
   ~IOPoll();
 
   bool watcherExists(int fd) const
   { return fd >= 0 && fd < watchers_.size() && watchers_[fd] != nullptr; }
 
-  void createWatcher(int fd);
+  int getFD() const { return fd_; }
+
+  void interrupt();
+  void createWatcher(int fd, bool isFile = false);
+  bool watcherIsFile(int fd) const;
+  bool watcherIsPollable(int fd) const;
+  bool eventIsReady(int fd, IOEvent event) const;
   void destroyWatcher(int fd);
   void addEventAwaiter(QUEUE *eventAwaiterQueueItem, int fd, IOEvent event);
   void removeEventAwaiter(const QUEUE &eventAwaiterQueueItem, int fd);
   void removeEventAwaiters(int fd, QUEUE *eventAwaiterQueue);
-  bool waitForEvents(int timeout, QUEUE *eventAwaiterQueue);
+  void addRequest(QUEUE *requestQueueItem, int fd);
+  const QUEUE *getRequestQueue(int fd) const;
+  bool enableZeroCopy(int fd);
+  void addZeroCopySend(int fd);
+  int reapZeroCopyCompletions(int fd);
+  void updateWatchers();
+  bool waitForEvents(int timeout, QUEUE *eventAwaiterQueue,
+                     const timespec *preciseTimeout = nullptr);
 
 private:
   const int fd_;
+  const int interruptionFd_;
+  const bool usesEdgeTrigger_;
   MemoryPool watcherMemoryPool_;
   std::vector<IOWatcher *> watchers_;
   QUEUE dirtyWatcherQueue_;
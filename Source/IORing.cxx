@@ -0,0 +1,228 @@
+#include "IORing.hxx"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#
+#include "Atomic.hxx"
+#include "Error.hxx"
+#include "Log.hxx"
+
+#define TARA_IO_RING_FEATURES (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | \
+                               IORING_FEAT_FAST_POLL | IORING_FEAT_EXT_ARG)
+
+namespace Tara {
+
+namespace {
+
+template <typename TYPE>
+TYPE *GetRingField(void *rings, unsigned int offset);
+
+void xmunmap(void *addr, size_t length);
+void xclose(int fd);
+
+} // namespace
+
+IORing::IORing(unsigned int entryCount)
+  : fd_(-1), rings_(nullptr), ringsSize_(0), submissions_(nullptr),
+    submissionsSize_(0), pendingSubmissionCount_(0)
+{
+  if (entryCount != 0 && !setUp(entryCount)) {
+    TARA_WARNING_LOG("io_uring unavailable, falling back to epoll");
+  }
+}
+
+IORing::~IORing()
+{
+  if (fd_ < 0) {
+    return;
+  }
+  xmunmap(submissions_, submissionsSize_);
+  xmunmap(rings_, ringsSize_);
+  xclose(fd_);
+}
+
+io_uring_sqe *IORing::getSubmission()
+{
+  assert(isEnabled());
+  unsigned int tail = *submissionTail_;
+  if (tail - Load(*submissionHead_) == submissionCount_) {
+    submit();
+    if (tail - Load(*submissionHead_) == submissionCount_) {
+      TARA_FATALITY_LOG("io_uring submission queue overflow");
+    }
+  }
+  io_uring_sqe *submission = &submissions_[tail & submissionMask_];
+  memset(submission, 0, sizeof *submission);
+  Store(*submissionTail_, tail + 1);
+  ++pendingSubmissionCount_;
+  return submission;
+}
+
+void IORing::submit()
+{
+  assert(isEnabled());
+  while (pendingSubmissionCount_ != 0 && enter(0, 0, nullptr, 0) < 0);
+}
+
+bool IORing::waitForCompletions(int timeout, const timespec *preciseTimeout)
+{
+  assert(isEnabled());
+  if (timeout == 0 || hasCompletions()) {
+    submit();
+    return true;
+  }
+  __kernel_timespec kernelTimeout;
+  io_uring_getevents_arg arg;
+  arg.sigmask = 0;
+  arg.sigmask_sz = _NSIG / 8;
+  arg.pad = 0;
+  arg.ts = 0;
+  if (preciseTimeout != nullptr) {
+    kernelTimeout.tv_sec = preciseTimeout->tv_sec;
+    kernelTimeout.tv_nsec = preciseTimeout->tv_nsec;
+    arg.ts = reinterpret_cast<uintptr_t>(&kernelTimeout);
+  } else if (timeout > 0) {
+    kernelTimeout.tv_sec = timeout / 1000;
+    kernelTimeout.tv_nsec = timeout % 1000 * 1000000;
+    arg.ts = reinterpret_cast<uintptr_t>(&kernelTimeout);
+  }
+  return enter(1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+               sizeof arg) >= 0;
+}
+
+unsigned int IORing::reapCompletions(io_uring_cqe *buffer,
+                                     unsigned int bufferLength)
+{
+  assert(isEnabled());
+  assert(buffer != nullptr || bufferLength == 0);
+  unsigned int head = *completionHead_;
+  unsigned int n = Load(*completionTail_) - head;
+  if (n > bufferLength) {
+    n = bufferLength;
+  }
+  for (unsigned int i = 0; i < n; ++i) {
+    buffer[i] = completions_[(head + i) & completionMask_];
+  }
+  Store(*completionHead_, head + n);
+  return n;
+}
+
+bool IORing::setUp(unsigned int entryCount)
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof params);
+  int fd = syscall(SYS_io_uring_setup, entryCount, &params);
+  if (fd < 0) {
+    return false;
+  }
+  if ((params.features & TARA_IO_RING_FEATURES) != TARA_IO_RING_FEATURES) {
+    xclose(fd);
+    return false;
+  }
+  size_t ringsSize = params.cq_off.cqes +
+                     params.cq_entries * sizeof(io_uring_cqe);
+  if (ringsSize < params.sq_off.array +
+                  params.sq_entries * sizeof(unsigned int)) {
+    ringsSize = params.sq_off.array +
+                params.sq_entries * sizeof(unsigned int);
+  }
+  void *rings = mmap(nullptr, ringsSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (rings == MAP_FAILED) {
+    xclose(fd);
+    return false;
+  }
+  size_t submissionsSize = params.sq_entries * sizeof(io_uring_sqe);
+  void *submissions = mmap(nullptr, submissionsSize, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (submissions == MAP_FAILED) {
+    xmunmap(rings, ringsSize);
+    xclose(fd);
+    return false;
+  }
+  fd_ = fd;
+  rings_ = rings;
+  ringsSize_ = ringsSize;
+  submissions_ = static_cast<io_uring_sqe *>(submissions);
+  submissionsSize_ = submissionsSize;
+  submissionHead_ = GetRingField<unsigned int>(rings, params.sq_off.head);
+  submissionTail_ = GetRingField<unsigned int>(rings, params.sq_off.tail);
+  submissionMask_ = *GetRingField<unsigned int>(rings,
+                                                params.sq_off.ring_mask);
+  submissionCount_ = params.sq_entries;
+  unsigned int *submissionArray = GetRingField<unsigned int>
+                                  (rings, params.sq_off.array);
+  for (unsigned int i = 0; i < submissionCount_; ++i) {
+    submissionArray[i] = i;
+  }
+  completionHead_ = GetRingField<unsigned int>(rings, params.cq_off.head);
+  completionTail_ = GetRingField<unsigned int>(rings, params.cq_off.tail);
+  completionMask_ = *GetRingField<unsigned int>(rings,
+                                                params.cq_off.ring_mask);
+  completions_ = GetRingField<io_uring_cqe>(rings, params.cq_off.cqes);
+  return true;
+}
+
+bool IORing::hasCompletions() const
+{
+  return Load(*completionTail_) != *completionHead_;
+}
+
+int IORing::enter(unsigned int minCompletionCount, unsigned int flags,
+                  const void *arg, size_t argSize)
+{
+  int n = syscall(SYS_io_uring_enter, fd_, pendingSubmissionCount_,
+                  minCompletionCount, flags, arg, argSize);
+  if (n < 0) {
+    if (errno == EINTR) {
+      return -1;
+    }
+    if (errno == ETIME || errno == EBUSY || errno == EAGAIN) {
+      return 0;
+    }
+    TARA_FATALITY_LOG("io_uring_enter failed: ", Error(errno));
+  }
+  pendingSubmissionCount_ -= n;
+  return n;
+}
+
+namespace {
+
+template <typename TYPE>
+TYPE *GetRingField(void *rings, unsigned int offset)
+{
+  return reinterpret_cast<TYPE *>(static_cast<unsigned char *>(rings) +
+                                  offset);
+}
+
+void xmunmap(void *addr, size_t length)
+{
+  if (munmap(addr, length) < 0) {
+    TARA_FATALITY_LOG("munmap failed: ", Error(errno));
+  }
+}
+
+void xclose(int fd)
+{
+  int result;
+  do {
+    result = close(fd);
+    if (result >= 0) {
+      break;
+    }
+  } while (errno == EINTR);
+  if (result < 0) {
+    TARA_FATALITY_LOG("close failed: ", Error(errno));
+  }
+}
+
+} // namespace
+
+} // namespace Tara
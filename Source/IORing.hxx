@@ -0,0 +1,48 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <time.h>
+
+namespace Tara {
+
+class IORing final
+{
+  IORing(const IORing &other) = delete;
+  void operator=(const IORing &other) = delete;
+
+public:
+  explicit IORing(unsigned int entryCount);
+  ~IORing();
+
+  bool isEnabled() const { return fd_ >= 0; }
+
+  io_uring_sqe *getSubmission();
+  void submit();
+  bool waitForCompletions(int timeout,
+                          const timespec *preciseTimeout = nullptr);
+  unsigned int reapCompletions(io_uring_cqe *buffer,
+                               unsigned int bufferLength);
+
+private:
+  int fd_;
+  void *rings_;
+  size_t ringsSize_;
+  io_uring_sqe *submissions_;
+  size_t submissionsSize_;
+  unsigned int *submissionHead_;
+  unsigned int *submissionTail_;
+  unsigned int submissionMask_;
+  unsigned int submissionCount_;
+  unsigned int pendingSubmissionCount_;
+  unsigned int *completionHead_;
+  unsigned int *completionTail_;
+  unsigned int completionMask_;
+  io_uring_cqe *completions_;
+
+  bool setUp(unsigned int entryCount);
+  bool hasCompletions() const;
+  int enter(unsigned int minCompletionCount, unsigned int flags,
+            const void *arg, size_t argSize);
+};
+
+} // namespace Tara
@@ -0,0 +1,64 @@
+#include "JoinHandle.hxx"
+
+#include <assert.h>
+#
+#include "Log.hxx"
+#include "TheScheduler.hxx"
+
+namespace Tara {
+
+JoinState::JoinState()
+  : scheduler_(TheScheduler), referenceCount_(1), isDone_(false),
+    waiter_(nullptr)
+{}
+
+JoinState::~JoinState()
+{
+  assert(waiter_ == nullptr);
+}
+
+void JoinState::release()
+{
+  assert(referenceCount_ != 0);
+  if (--referenceCount_ == 0) {
+    delete this;
+  }
+}
+
+void JoinState::wait()
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (isDone_) {
+    return;
+  }
+  JoinWaiter waiter;
+  waiter_ = &waiter;
+  AwaitJoin(&waiter);
+  waiter_ = nullptr;
+}
+
+void JoinState::complete()
+{
+  assert(!isDone_);
+  CHECK_THE_OWNER(scheduler_);
+  isDone_ = true;
+  if (waiter_ != nullptr && waiter_->doneState == nullptr) {
+    waiter_->doneState = this;
+    TheScheduler->resumeFiber(waiter_->fiber);
+  }
+}
+
+void JoinState::reportMissingResult() const
+{
+  TARA_FATALITY_LOG("joined fiber exited without a result");
+}
+
+void AwaitJoin(JoinWaiter *waiter)
+{
+  CHECK_THE_SCHEDULER;
+  assert(waiter != nullptr);
+  waiter->fiber = TheScheduler->getCurrentFiber();
+  TheScheduler->suspendCurrentFiber();
+}
+
+} // namespace Tara
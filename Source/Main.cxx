@@ -1,4 +1,8 @@
+#include <unistd.h>
+#
 #include "Scheduler.hxx"
+#include "SchedulerGroup.hxx"
+#include "Settings.hxx"
 
 namespace Tara {
 
@@ -11,11 +15,24 @@ int TaraMain(int argc, char **argv);
 int main(int argc, char **argv)
 {
   int status = 0;
-  Tara::Scheduler scheduler;
-  Tara::TheScheduler = &scheduler;
-  scheduler.callCoroutine([argc, argv, &status] () {
-    status = TaraMain(argc, argv);
-  });
-  scheduler.run();
+  unsigned long schedulerCount = Tara::GetSetting("TARA_SCHEDULER_COUNT", 1);
+  if (schedulerCount == 0) {
+    long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    schedulerCount = processorCount >= 1 ? processorCount : 1;
+  }
+  if (schedulerCount == 1) {
+    Tara::Scheduler scheduler;
+    Tara::TheScheduler = &scheduler;
+    scheduler.callCoroutine([argc, argv, &status] () {
+      status = TaraMain(argc, argv);
+    });
+    scheduler.run();
+  } else {
+    Tara::SchedulerGroup schedulerGroup(schedulerCount);
+    schedulerGroup.getScheduler(0)->callCoroutine([argc, argv, &status] () {
+      status = TaraMain(argc, argv);
+    });
+    schedulerGroup.run();
+  }
   return status;
 }
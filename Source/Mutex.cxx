@@ -0,0 +1,55 @@
+#include "Mutex.hxx"
+
+#include <assert.h>
+#
+#include "libuv/queue.h"
+#
+#include "TheScheduler.hxx"
+
+namespace Tara {
+
+Mutex::Mutex()
+  : scheduler_(nullptr), isLocked_(false)
+{
+  QUEUE_INIT(&waiterQueue_);
+}
+
+Mutex::~Mutex()
+{
+  assert(!isLocked_);
+  assert(QUEUE_EMPTY(&waiterQueue_));
+}
+
+void Mutex::lock()
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (!isLocked_) {
+    isLocked_ = true;
+    return;
+  }
+  TheScheduler->suspendCurrentFiber(&waiterQueue_, -1);
+  assert(isLocked_);
+}
+
+bool Mutex::tryLock()
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (isLocked_) {
+    return false;
+  }
+  isLocked_ = true;
+  return true;
+}
+
+void Mutex::unlock()
+{
+  assert(isLocked_);
+  CHECK_THE_OWNER(scheduler_);
+  if (QUEUE_EMPTY(&waiterQueue_)) {
+    isLocked_ = false;
+    return;
+  }
+  TheScheduler->resumeFiber(&waiterQueue_);
+}
+
+} // namespace Tara
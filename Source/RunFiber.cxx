@@ -1,18 +1,30 @@
-__asm__ __volatile__ (".globl TaraRunFiber");
+__asm__ (".globl TaraRunFiber");
 
 #if defined __i386__
 
-// param1: 4(%esp): fiberStart
-// param2: 8(%esp): scheduler
-// param3: 12(%esp): stack
-// param4: 16(%esp): stackSize
+// param1: 4(%esp): context
+// param2: 8(%esp): fiberStart
+// param3: 12(%esp): scheduler
+// param4: 16(%esp): stack
+// param5: 20(%esp): stackSize
 
-__asm__ __volatile__ (" \
+__asm__ (" \
 TaraRunFiber:           \
 \n\tmovl 4(%esp), %eax  \
-\n\tmovl 8(%esp), %edx  \
-\n\tmovl 12(%esp), %ecx \
-\n\taddl 16(%esp), %ecx \
+\n\tpushl %ebp          \
+\n\tpushl %ebx          \
+\n\tpushl %esi          \
+\n\tpushl %edi          \
+\n\tsubl $8, %esp       \
+\n\tfnstcw 4(%esp)      "
+#if defined __SSE__
+"\n\tstmxcsr (%esp)     "
+#endif
+"\n\tmovl %esp, (%eax)  \
+\n\tmovl 32(%esp), %eax \
+\n\tmovl 36(%esp), %edx \
+\n\tmovl 40(%esp), %ecx \
+\n\taddl 44(%esp), %ecx \
 \n\tmovl $0, %ebp       \
 \n\tmovl %ecx, %esp     \
 \n\tpushl %edx          \
@@ -22,18 +34,29 @@ TaraRunFiber:           \
 
 #elif defined __x86_64__
 
-// param1: %rdi: fiberStart
-// param2: %rsi: scheduler
-// param3: %rdx: stack
-// param4: %rcx: stackSize
+// param1: %rdi: context
+// param2: %rsi: fiberStart
+// param3: %rdx: scheduler
+// param4: %rcx: stack
+// param5: %r8: stackSize
 
-__asm__ __volatile__ ("     \
-TaraRunFiber:               \
-\n\tmovq $0, %rbp           \
-\n\tleaq (%rdx, %rcx), %rsp \
-\n\txchgq %rsi, %rdi        \
-\n\tpushq $0                \
-\n\tjmpq *%rsi              \
+__asm__ ("    \
+TaraRunFiber:              \
+\n\tpushq %rbp             \
+\n\tpushq %rbx             \
+\n\tpushq %r12             \
+\n\tpushq %r13             \
+\n\tpushq %r14             \
+\n\tpushq %r15             \
+\n\tsubq $8, %rsp          \
+\n\tstmxcsr (%rsp)         \
+\n\tfnstcw 4(%rsp)         \
+\n\tmovq %rsp, (%rdi)      \
+\n\tmovq %rdx, %rdi        \
+\n\tmovq $0, %rbp          \
+\n\tleaq (%rcx, %r8), %rsp \
+\n\tpushq $0               \
+\n\tjmpq *%rsi             \
 ");
 
 #else
@@ -10,9 +10,9 @@ class Scheduler;
 
 extern "C" {
 
-[[noreturn]] void TaraRunFiber(void (*fiberStart)(Scheduler *),
-                               Scheduler *scheduler, unsigned char *stack,
-                               size_t stackSize);
+void TaraRunFiber(void **context, void (*fiberStart)(Scheduler *),
+                  Scheduler *scheduler, unsigned char *stack,
+                  size_t stackSize);
 
 } // extern "C"
 
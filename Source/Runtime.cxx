@@ -2,40 +2,83 @@
 
 #include <fcntl.h>
 #include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #
+#include <assert.h>
 #include <errno.h>
+#include <stdint.h>
 #
 #include <utility>
+#include <vector>
 #
 #include "IOEvent.hxx"
-#include "Log.hxx"
-#include "Scheduler.hxx"
-
-#define CHECK_THE_SCHEDULER              \
-  do {                                   \
-    if (TheScheduler == nullptr) {       \
-      TARA_FATALITY_LOG("No scheduler"); \
-    }                                    \
-  } while (false)
+#include "TheScheduler.hxx"
+#include "Utility.hxx"
 
 namespace Tara {
 
-extern thread_local Scheduler *const TheScheduler;
+namespace {
+
+bool IsFile(int fd);
+ssize_t ReadFile(int fd, const iovec *iov, int iovcnt);
+ssize_t WriteFile(int fd, const iovec *iov, int iovcnt);
+size_t GetIOVectorSize(const iovec *iov, int iovcnt);
+void SkipIOVector(std::vector<iovec> *iovs, size_t n);
+void SetSocketBusyPoll(int fd);
+int SyncFiles(const int *fds, unsigned int fdCount, int (*sync)(int fd));
+bool IOIsAwaitable(int fd);
+int AwaitTransfer(int fdin, int fdout, int *readyFD, int timeout);
+io_uring_sqe MakeIORequest(int opcode, int fd, const void *buf,
+                           size_t buflen);
+
+} // namespace
+
+void CallCoroutine(const CoroutineType &coroutineType, const void *coroutine,
+                  size_t stackSize)
+{
+  CHECK_THE_SCHEDULER;
+  TheScheduler->callCoroutine(coroutineType, coroutine, stackSize);
+}
+
+void DispatchCoroutine(const CoroutineType &coroutineType,
+                       const void *coroutine, size_t stackSize)
+{
+  CHECK_THE_SCHEDULER;
+  TheScheduler->dispatchCoroutine(coroutineType, coroutine, stackSize);
+}
+
+void Call(const Coroutine &coroutine, size_t stackSize)
+{
+  CHECK_THE_SCHEDULER;
+  if (coroutine != nullptr) {
+    TheScheduler->callCoroutine(coroutine, stackSize);
+  }
+}
+
+void Call(Coroutine &&coroutine, size_t stackSize)
+{
+  CHECK_THE_SCHEDULER;
+  if (coroutine != nullptr) {
+    TheScheduler->callCoroutine(std::move(coroutine), stackSize);
+  }
+}
 
-void Call(const Coroutine &coroutine)
+void Dispatch(const Coroutine &coroutine, size_t stackSize)
 {
   CHECK_THE_SCHEDULER;
   if (coroutine != nullptr) {
-    TheScheduler->callCoroutine(coroutine);
+    TheScheduler->dispatchCoroutine(coroutine, stackSize);
   }
 }
 
-void Call(Coroutine &&coroutine)
+void Dispatch(Coroutine &&coroutine, size_t stackSize)
 {
   CHECK_THE_SCHEDULER;
   if (coroutine != nullptr) {
-    TheScheduler->callCoroutine(std::move(coroutine));
+    TheScheduler->dispatchCoroutine(std::move(coroutine), stackSize);
   }
 }
 
@@ -51,6 +94,36 @@ void Sleep(int duration)
   TheScheduler->sleepCurrentFiber(duration);
 }
 
+void Sleep(const timespec &duration)
+{
+  CHECK_THE_SCHEDULER;
+  TheScheduler->sleepCurrentFiber(duration);
+}
+
+int GetTimerSlack()
+{
+  CHECK_THE_SCHEDULER;
+  return TheScheduler->getTimerSlack();
+}
+
+void SetTimerSlack(int timerSlack)
+{
+  CHECK_THE_SCHEDULER;
+  TheScheduler->setTimerSlack(timerSlack);
+}
+
+void GetBusyPollCounters(unsigned long *spinHitCount,
+                         unsigned long *blockingWaitCount)
+{
+  CHECK_THE_SCHEDULER;
+  if (spinHitCount != nullptr) {
+    *spinHitCount = TheScheduler->getSpinHitCount();
+  }
+  if (blockingWaitCount != nullptr) {
+    *blockingWaitCount = TheScheduler->getBlockingWaitCount();
+  }
+}
+
 void Exit()
 {
   CHECK_THE_SCHEDULER;
@@ -70,7 +143,7 @@ int Open(const char *path, int flags, mode_t mode)
   if (fd < 0) {
     return -1;
   }
-  TheScheduler->watchIO(fd);
+  TheScheduler->watchIO(fd, IsFile(fd));
   return fd;
 }
 
@@ -92,6 +165,7 @@ int Socket(int domain, int type, int protocol)
   if (fd < 0) {
     return -1;
   }
+  SetSocketBusyPoll(fd);
   TheScheduler->watchIO(fd);
   return fd;
 }
@@ -117,6 +191,40 @@ int Close(int fd)
   return 0;
 }
 
+int Attach(int fd)
+{
+  CHECK_THE_SCHEDULER;
+  if (fd < 0) {
+    errno = EBADF;
+    return -1;
+  }
+  if (TheScheduler->ioIsWatched(fd)) {
+    errno = EEXIST;
+    return -1;
+  }
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0) {
+    return -1;
+  }
+  if ((flags & O_NONBLOCK) == 0 &&
+      fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    return -1;
+  }
+  TheScheduler->watchIO(fd, IsFile(fd));
+  return 0;
+}
+
+int Detach(int fd)
+{
+  CHECK_THE_SCHEDULER;
+  if (!TheScheduler->ioIsWatched(fd)) {
+    errno = EBADF;
+    return -1;
+  }
+  TheScheduler->unwatchIO(fd);
+  return 0;
+}
+
 ssize_t Read(int fd, void *buf, size_t buflen, int timeout)
 {
   CHECK_THE_SCHEDULER;
@@ -124,6 +232,19 @@ ssize_t Read(int fd, void *buf, size_t buflen, int timeout)
     errno = EBADF;
     return -1;
   }
+  if (TheScheduler->usesIORing()) {
+    io_uring_sqe request = MakeIORequest(IORING_OP_READ, fd, buf, buflen);
+    request.off = UINT64_MAX;
+    return TheScheduler->awaitIORequest(request, timeout);
+  }
+  if (TheScheduler->ioIsFile(fd)) {
+    iovec iov = {buf, buflen};
+    return ReadFile(fd, &iov, 1);
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Readability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Readability, timeout) < 0) {
+    return -1;
+  }
   ssize_t n;
   for (;;) {
     n = read(fd, buf, buflen);
@@ -154,6 +275,19 @@ ssize_t Write(int fd, const void *buf, size_t buflen, int timeout)
     errno = EBADF;
     return -1;
   }
+  if (TheScheduler->usesIORing()) {
+    io_uring_sqe request = MakeIORequest(IORING_OP_WRITE, fd, buf, buflen);
+    request.off = UINT64_MAX;
+    return TheScheduler->awaitIORequest(request, timeout);
+  }
+  if (TheScheduler->ioIsFile(fd)) {
+    iovec iov = {const_cast<void *>(buf), buflen};
+    return WriteFile(fd, &iov, 1);
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Writability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
+    return -1;
+  }
   ssize_t n;
   for (;;) {
     n = write(fd, buf, buflen);
@@ -185,6 +319,22 @@ int Accept4(int fd, sockaddr *addr, socklen_t *addrlen, int flags, int timeout)
     return -1;
   }
   int subfd;
+  if (TheScheduler->usesIORing()) {
+    io_uring_sqe request = MakeIORequest(IORING_OP_ACCEPT, fd, addr, 0);
+    request.addr2 = reinterpret_cast<uintptr_t>(addrlen);
+    request.accept_flags = flags | SOCK_NONBLOCK;
+    subfd = TheScheduler->awaitIORequest(request, timeout);
+    if (subfd < 0) {
+      return -1;
+    }
+    SetSocketBusyPoll(subfd);
+    TheScheduler->watchIO(subfd);
+    return subfd;
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Readability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Readability, timeout) < 0) {
+    return -1;
+  }
   for (;;) {
     subfd = accept4(fd, addr, addrlen, flags | SOCK_NONBLOCK);
     if (subfd >= 0) {
@@ -204,6 +354,7 @@ int Accept4(int fd, sockaddr *addr, socklen_t *addrlen, int flags, int timeout)
   if (subfd < 0) {
     return -1;
   }
+  SetSocketBusyPoll(subfd);
   TheScheduler->watchIO(subfd);
   return subfd;
 }
@@ -215,6 +366,11 @@ int Connect(int fd, const sockaddr *addr, socklen_t addrlen, int timeout)
     errno = EBADF;
     return -1;
   }
+  if (TheScheduler->usesIORing()) {
+    io_uring_sqe request = MakeIORequest(IORING_OP_CONNECT, fd, addr, 0);
+    request.off = addrlen;
+    return TheScheduler->awaitIORequest(request, timeout);
+  }
   if (connect(fd, addr, addrlen) < 0) {
     if (errno != EINTR && errno != EINPROGRESS) {
       return -1;
@@ -242,6 +398,15 @@ ssize_t Recv(int fd, void *buf, size_t buflen, int flags, int timeout)
     errno = EBADF;
     return -1;
   }
+  if (TheScheduler->usesIORing()) {
+    io_uring_sqe request = MakeIORequest(IORING_OP_RECV, fd, buf, buflen);
+    request.msg_flags = flags;
+    return TheScheduler->awaitIORequest(request, timeout);
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Readability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Readability, timeout) < 0) {
+    return -1;
+  }
   ssize_t n;
   for (;;) {
     n = recv(fd, buf, buflen, flags);
@@ -272,6 +437,15 @@ ssize_t Send(int fd, const void *buf, size_t buflen, int flags, int timeout)
     errno = EBADF;
     return -1;
   }
+  if (TheScheduler->usesIORing()) {
+    io_uring_sqe request = MakeIORequest(IORING_OP_SEND, fd, buf, buflen);
+    request.msg_flags = flags;
+    return TheScheduler->awaitIORequest(request, timeout);
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Writability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
+    return -1;
+  }
   ssize_t n;
   for (;;) {
     n = send(fd, buf, buflen, flags);
@@ -303,6 +477,10 @@ ssize_t RecvFrom(int fd, void *buf, size_t buflen, int flags, sockaddr *addr,
     errno = EBADF;
     return -1;
   }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Readability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Readability, timeout) < 0) {
+    return -1;
+  }
   ssize_t n;
   for (;;) {
     n = recvfrom(fd, buf, buflen, flags, addr, addrlen);
@@ -334,6 +512,10 @@ ssize_t SendTo(int fd, const void *buf, size_t buflen, int flags,
     errno = EBADF;
     return -1;
   }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Writability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
+    return -1;
+  }
   ssize_t n;
   for (;;) {
     n = sendto(fd, buf, buflen, flags, addr, addrlen);
@@ -357,100 +539,982 @@ ssize_t SendTo(int fd, const void *buf, size_t buflen, int flags,
   return n;
 }
 
-int OpenAsync(const char *path, int flags, mode_t mode)
+ssize_t Readv(int fd, const iovec *iov, int iovcnt, int timeout)
 {
   CHECK_THE_SCHEDULER;
-  int fd;
-  int errorNumber = 0;
-  Task task([&path, &flags, &mode, &fd, &errorNumber] {
-    do {
-      fd = open(path, flags & ~O_NONBLOCK, mode);
-      if (fd >= 0) {
+  if (!TheScheduler->ioIsWatched(fd)) {
+    errno = EBADF;
+    return -1;
+  }
+  if (TheScheduler->usesIORing()) {
+    io_uring_sqe request = MakeIORequest(IORING_OP_READV, fd, iov, iovcnt);
+    request.off = UINT64_MAX;
+    return TheScheduler->awaitIORequest(request, timeout);
+  }
+  if (TheScheduler->ioIsFile(fd)) {
+    return ReadFile(fd, iov, iovcnt);
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Readability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Readability, timeout) < 0) {
+    return -1;
+  }
+  ssize_t n;
+  for (;;) {
+    n = readv(fd, iov, iovcnt);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EWOULDBLOCK) {
+      if (TheScheduler->awaitIOEvent(fd, IOEvent::Readability, timeout) < 0) {
         break;
       }
-    } while (errno == EINTR);
-    if (fd < 0) {
-      errorNumber = errno;
+      continue;
     }
-  });
-  TheScheduler->awaitTask(&task);
-  if (errorNumber != 0) {
-    errno = errorNumber;
+    if (errno == EINTR) {
+      continue;
+    }
+    break;
+  }
+  if (n < 0) {
     return -1;
   }
-  return fd;
+  return n;
 }
 
-int CloseAsync(int fd)
+ssize_t Writev(int fd, const iovec *iov, int iovcnt, int timeout)
 {
   CHECK_THE_SCHEDULER;
-  int result;
-  int errorNumber = 0;
-  Task task([&fd, &result, &errorNumber] {
-    do {
-      result = close(fd);
-      if (result >= 0) {
+  if (!TheScheduler->ioIsWatched(fd)) {
+    errno = EBADF;
+    return -1;
+  }
+  if (TheScheduler->usesIORing()) {
+    io_uring_sqe request = MakeIORequest(IORING_OP_WRITEV, fd, iov, iovcnt);
+    request.off = UINT64_MAX;
+    return TheScheduler->awaitIORequest(request, timeout);
+  }
+  if (TheScheduler->ioIsFile(fd)) {
+    return WriteFile(fd, iov, iovcnt);
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Writability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
+    return -1;
+  }
+  ssize_t n;
+  for (;;) {
+    n = writev(fd, iov, iovcnt);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EWOULDBLOCK) {
+      if (TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
         break;
       }
-    } while (errno == EINTR);
-    if (result < 0) {
-      errorNumber = errno;
+      continue;
     }
-  });
-  TheScheduler->awaitTask(&task);
-  if (errorNumber != 0) {
-    errno = errorNumber;
+    if (errno == EINTR) {
+      continue;
+    }
+    break;
+  }
+  if (n < 0) {
     return -1;
   }
-  return result;
+  return n;
 }
 
-ssize_t ReadAsync(int fd, void *buf, size_t buflen)
+ssize_t RecvMsg(int fd, msghdr *msg, int flags, int timeout)
 {
   CHECK_THE_SCHEDULER;
+  if (!TheScheduler->ioIsWatched(fd)) {
+    errno = EBADF;
+    return -1;
+  }
+  if (TheScheduler->usesIORing()) {
+    io_uring_sqe request = MakeIORequest(IORING_OP_RECVMSG, fd, msg, 1);
+    request.msg_flags = flags;
+    return TheScheduler->awaitIORequest(request, timeout);
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Readability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Readability, timeout) < 0) {
+    return -1;
+  }
   ssize_t n;
-  int errorNumber = 0;
-  Task task([&fd, &buf, &buflen, &n, &errorNumber] {
-    do {
-      n = read(fd, buf, buflen);
-      if (n >= 0) {
+  for (;;) {
+    n = recvmsg(fd, msg, flags);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EWOULDBLOCK) {
+      if (TheScheduler->awaitIOEvent(fd, IOEvent::Readability, timeout) < 0) {
         break;
       }
-    } while (errno == EINTR);
-    if (n < 0) {
-      errorNumber = errno;
+      continue;
     }
-  });
-  TheScheduler->awaitTask(&task);
-  if (errorNumber != 0) {
-    errno = errorNumber;
+    if (errno == EINTR) {
+      continue;
+    }
+    break;
+  }
+  if (n < 0) {
     return -1;
   }
   return n;
 }
 
-ssize_t WriteAsync(int fd, const void *buf, size_t buflen)
+ssize_t SendMsg(int fd, const msghdr *msg, int flags, int timeout)
 {
   CHECK_THE_SCHEDULER;
+  if (!TheScheduler->ioIsWatched(fd)) {
+    errno = EBADF;
+    return -1;
+  }
+  if (TheScheduler->usesIORing()) {
+    io_uring_sqe request = MakeIORequest(IORING_OP_SENDMSG, fd, msg, 1);
+    request.msg_flags = flags;
+    return TheScheduler->awaitIORequest(request, timeout);
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Writability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
+    return -1;
+  }
   ssize_t n;
-  int errorNumber = 0;
-  Task task([&fd, &buf, &buflen, &n, &errorNumber] {
-    do {
-      n = write(fd, buf, buflen);
-      if (n >= 0) {
+  for (;;) {
+    n = sendmsg(fd, msg, flags);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EWOULDBLOCK) {
+      if (TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
         break;
       }
-    } while (errno == EINTR);
-    if (n < 0) {
-      errorNumber = errno;
+      continue;
     }
-  });
-  TheScheduler->awaitTask(&task);
-  if (errorNumber != 0) {
-    errno = errorNumber;
+    if (errno == EINTR) {
+      continue;
+    }
+    break;
+  }
+  if (n < 0) {
     return -1;
   }
   return n;
 }
 
+int RecvMmsg(int fd, mmsghdr *msgvec, unsigned int vlen, int flags,
+             int timeout)
+{
+  CHECK_THE_SCHEDULER;
+  if (!TheScheduler->ioIsWatched(fd)) {
+    errno = EBADF;
+    return -1;
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Readability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Readability, timeout) < 0) {
+    return -1;
+  }
+  int n;
+  for (;;) {
+    n = recvmmsg(fd, msgvec, vlen, flags, nullptr);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EWOULDBLOCK) {
+      if (TheScheduler->awaitIOEvent(fd, IOEvent::Readability, timeout) < 0) {
+        break;
+      }
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    break;
+  }
+  if (n < 0) {
+    return -1;
+  }
+  return n;
+}
+
+int SendMmsg(int fd, mmsghdr *msgvec, unsigned int vlen, int flags,
+             int timeout)
+{
+  CHECK_THE_SCHEDULER;
+  if (!TheScheduler->ioIsWatched(fd)) {
+    errno = EBADF;
+    return -1;
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Writability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
+    return -1;
+  }
+  int n;
+  for (;;) {
+    n = sendmmsg(fd, msgvec, vlen, flags);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EWOULDBLOCK) {
+      if (TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
+        break;
+      }
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    break;
+  }
+  if (n < 0) {
+    return -1;
+  }
+  return n;
+}
+
+ssize_t SendZeroCopy(int fd, const void *buf, size_t buflen, int flags,
+                     int timeout)
+{
+  CHECK_THE_SCHEDULER;
+  if (!TheScheduler->ioIsWatched(fd)) {
+    errno = EBADF;
+    return -1;
+  }
+  if (!TheScheduler->enableZeroCopy(fd)) {
+    return Send(fd, buf, buflen, flags, timeout);
+  }
+  if (!TheScheduler->ioIsReady(fd, IOEvent::Writability) &&
+      TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
+    return -1;
+  }
+  ssize_t n;
+  for (;;) {
+    n = send(fd, buf, buflen, flags | MSG_ZEROCOPY);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EWOULDBLOCK) {
+      if (TheScheduler->awaitIOEvent(fd, IOEvent::Writability, timeout) < 0) {
+        break;
+      }
+      continue;
+    }
+    if (errno == ENOBUFS) {
+      return Send(fd, buf, buflen, flags, timeout);
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    break;
+  }
+  if (n < 0) {
+    return -1;
+  }
+  if (n != 0) {
+    TheScheduler->addZeroCopySend(fd);
+  }
+  return n;
+}
+
+int WaitZeroCopySends(int fd, int timeout)
+{
+  CHECK_THE_SCHEDULER;
+  if (!TheScheduler->ioIsWatched(fd)) {
+    errno = EBADF;
+    return -1;
+  }
+  return TheScheduler->awaitZeroCopySends(fd, timeout);
+}
+
+ssize_t Sendfile(int outfd, int infd, off_t *offset, size_t count, int timeout)
+{
+  CHECK_THE_SCHEDULER;
+  if (!TheScheduler->ioIsWatched(outfd)) {
+    errno = EBADF;
+    return -1;
+  }
+  if (!TheScheduler->ioIsReady(outfd, IOEvent::Writability) &&
+      TheScheduler->awaitIOEvent(outfd, IOEvent::Writability, timeout) < 0) {
+    return -1;
+  }
+  ssize_t n;
+  for (;;) {
+    n = sendfile(outfd, infd, offset, count);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EWOULDBLOCK) {
+      if (TheScheduler->awaitIOEvent(outfd, IOEvent::Writability,
+                                     timeout) < 0) {
+        break;
+      }
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    break;
+  }
+  if (n < 0) {
+    return -1;
+  }
+  return n;
+}
+
+ssize_t Splice(int fdin, loff_t *offin, int fdout, loff_t *offout, size_t len,
+               unsigned int flags, int timeout)
+{
+  CHECK_THE_SCHEDULER;
+  if (!TheScheduler->ioIsWatched(fdin) && !TheScheduler->ioIsWatched(fdout)) {
+    errno = EBADF;
+    return -1;
+  }
+  int readyFD = -1;
+  ssize_t n;
+  for (;;) {
+    n = splice(fdin, offin, fdout, offout, len, flags | SPLICE_F_NONBLOCK);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EWOULDBLOCK) {
+      if (AwaitTransfer(fdin, fdout, &readyFD, timeout) < 0) {
+        break;
+      }
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    break;
+  }
+  if (n < 0) {
+    return -1;
+  }
+  return n;
+}
+
+ssize_t Tee(int fdin, int fdout, size_t len, unsigned int flags, int timeout)
+{
+  CHECK_THE_SCHEDULER;
+  if (!TheScheduler->ioIsWatched(fdin) && !TheScheduler->ioIsWatched(fdout)) {
+    errno = EBADF;
+    return -1;
+  }
+  int readyFD = -1;
+  ssize_t n;
+  for (;;) {
+    n = tee(fdin, fdout, len, flags | SPLICE_F_NONBLOCK);
+    if (n >= 0) {
+      break;
+    }
+    if (errno == EWOULDBLOCK) {
+      if (AwaitTransfer(fdin, fdout, &readyFD, timeout) < 0) {
+        break;
+      }
+      continue;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    break;
+  }
+  if (n < 0) {
+    return -1;
+  }
+  return n;
+}
+
+int WaitAny(pollfd *fds, nfds_t nfds, int timeout)
+{
+  CHECK_THE_SCHEDULER;
+  for (nfds_t i = 0; i < nfds; ++i) {
+    if (fds[i].fd >= 0 &&
+        (fds[i].events & ~(POLLIN | POLLOUT | POLLERR | POLLHUP)) != 0) {
+      errno = EINVAL;
+      return -1;
+    }
+  }
+  int n = 0;
+  for (nfds_t i = 0; i < nfds; ++i) {
+    fds[i].revents = 0;
+    if (fds[i].fd >= 0 && !TheScheduler->ioIsWatched(fds[i].fd)) {
+      fds[i].revents = POLLNVAL;
+      ++n;
+    }
+  }
+  if (n != 0) {
+    return n;
+  }
+  do {
+    n = poll(fds, nfds, 0);
+    if (n >= 0) {
+      break;
+    }
+  } while (errno == EINTR);
+  if (n != 0) {
+    return n;
+  }
+  return TheScheduler->awaitIOEvents(fds, nfds, timeout);
+}
+
+int OpenAsync(const char *path, int flags, mode_t mode)
+{
+  CHECK_THE_SCHEDULER;
+  int fd;
+  int errorNumber = 0;
+  Task task([&path, &flags, &mode, &fd, &errorNumber] {
+    do {
+      fd = open(path, flags & ~O_NONBLOCK, mode);
+      if (fd >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (fd < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return fd;
+}
+
+int CloseAsync(int fd)
+{
+  CHECK_THE_SCHEDULER;
+  int result;
+  int errorNumber = 0;
+  Task task([&fd, &result, &errorNumber] {
+    do {
+      result = close(fd);
+      if (result >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (result < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return result;
+}
+
+ssize_t ReadAsync(int fd, void *buf, size_t buflen)
+{
+  CHECK_THE_SCHEDULER;
+  ssize_t n;
+  int errorNumber = 0;
+  Task task([&fd, &buf, &buflen, &n, &errorNumber] {
+    do {
+      n = read(fd, buf, buflen);
+      if (n >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (n < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return n;
+}
+
+ssize_t WriteAsync(int fd, const void *buf, size_t buflen)
+{
+  CHECK_THE_SCHEDULER;
+  ssize_t n;
+  int errorNumber = 0;
+  Task task([&fd, &buf, &buflen, &n, &errorNumber] {
+    do {
+      n = write(fd, buf, buflen);
+      if (n >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (n < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return n;
+}
+
+ssize_t PreadAsync(int fd, void *buf, size_t buflen, off_t offset)
+{
+  CHECK_THE_SCHEDULER;
+  ssize_t n;
+  int errorNumber = 0;
+  Task task([&fd, &buf, &buflen, &offset, &n, &errorNumber] {
+    do {
+      n = pread(fd, buf, buflen, offset);
+      if (n >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (n < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return n;
+}
+
+ssize_t PwriteAsync(int fd, const void *buf, size_t buflen, off_t offset)
+{
+  CHECK_THE_SCHEDULER;
+  ssize_t n;
+  int errorNumber = 0;
+  Task task([&fd, &buf, &buflen, &offset, &n, &errorNumber] {
+    do {
+      n = pwrite(fd, buf, buflen, offset);
+      if (n >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (n < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return n;
+}
+
+int FsyncAsync(int fd)
+{
+  CHECK_THE_SCHEDULER;
+  int result;
+  int errorNumber = 0;
+  Task task([&fd, &result, &errorNumber] {
+    do {
+      result = fsync(fd);
+      if (result >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (result < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return result;
+}
+
+int FdatasyncAsync(int fd)
+{
+  CHECK_THE_SCHEDULER;
+  int result;
+  int errorNumber = 0;
+  Task task([&fd, &result, &errorNumber] {
+    do {
+      result = fdatasync(fd);
+      if (result >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (result < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return result;
+}
+
+int StatAsync(const char *path, struct stat *buf)
+{
+  CHECK_THE_SCHEDULER;
+  int result;
+  int errorNumber = 0;
+  Task task([&path, &buf, &result, &errorNumber] {
+    do {
+      result = stat(path, buf);
+      if (result >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (result < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return result;
+}
+
+int FstatAsync(int fd, struct stat *buf)
+{
+  CHECK_THE_SCHEDULER;
+  int result;
+  int errorNumber = 0;
+  Task task([&fd, &buf, &result, &errorNumber] {
+    do {
+      result = fstat(fd, buf);
+      if (result >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (result < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return result;
+}
+
+int FallocateAsync(int fd, int mode, off_t offset, off_t len)
+{
+  CHECK_THE_SCHEDULER;
+  int result;
+  int errorNumber = 0;
+  Task task([&fd, &mode, &offset, &len, &result, &errorNumber] {
+    do {
+      result = fallocate(fd, mode, offset, len);
+      if (result >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (result < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    errno = errorNumber;
+    return -1;
+  }
+  return result;
+}
+
+void PreadAsync(FileIORequest *requests, unsigned int requestCount)
+{
+  CHECK_THE_SCHEDULER;
+  std::vector<Task> tasks;
+  tasks.reserve(requestCount);
+  for (unsigned int i = 0; i < requestCount; ++i) {
+    FileIORequest *request = &requests[i];
+    tasks.emplace_back([request] {
+      ssize_t n;
+      do {
+        n = pread(request->fd, request->buf, request->buflen, request->offset);
+        if (n >= 0) {
+          break;
+        }
+      } while (errno == EINTR);
+      request->result = n < 0 ? -errno : n;
+    });
+  }
+  TheScheduler->awaitTasks(tasks.data(), requestCount);
+}
+
+void PwriteAsync(FileIORequest *requests, unsigned int requestCount)
+{
+  CHECK_THE_SCHEDULER;
+  std::vector<Task> tasks;
+  tasks.reserve(requestCount);
+  for (unsigned int i = 0; i < requestCount; ++i) {
+    FileIORequest *request = &requests[i];
+    tasks.emplace_back([request] {
+      ssize_t n;
+      do {
+        n = pwrite(request->fd, request->buf, request->buflen,
+                   request->offset);
+        if (n >= 0) {
+          break;
+        }
+      } while (errno == EINTR);
+      request->result = n < 0 ? -errno : n;
+    });
+  }
+  TheScheduler->awaitTasks(tasks.data(), requestCount);
+}
+
+int FsyncAsync(const int *fds, unsigned int fdCount)
+{
+  CHECK_THE_SCHEDULER;
+  return SyncFiles(fds, fdCount, fsync);
+}
+
+int FdatasyncAsync(const int *fds, unsigned int fdCount)
+{
+  CHECK_THE_SCHEDULER;
+  return SyncFiles(fds, fdCount, fdatasync);
+}
+
+namespace {
+
+bool IsFile(int fd)
+{
+  struct stat buf;
+  if (fstat(fd, &buf) < 0) {
+    return false;
+  }
+  return S_ISREG(buf.st_mode) || S_ISBLK(buf.st_mode);
+}
+
+ssize_t ReadFile(int fd, const iovec *iov, int iovcnt)
+{
+  size_t size = GetIOVectorSize(iov, iovcnt);
+  std::vector<iovec> iovs;
+  size_t n = 0;
+  for (;;) {
+    ssize_t m;
+    do {
+      m = preadv2(fd, iov, iovcnt, -1, RWF_NOWAIT);
+      if (m >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (m < 0) {
+      if (errno != EWOULDBLOCK && errno != EOPNOTSUPP) {
+        return n != 0 ? static_cast<ssize_t>(n) : -1;
+      }
+      break;
+    }
+    n += m;
+    if (m == 0 || n == size) {
+      return n;
+    }
+    if (iovs.empty()) {
+      iovs.assign(iov, iov + iovcnt);
+    }
+    SkipIOVector(&iovs, m);
+    iov = iovs.data();
+    iovcnt = iovs.size();
+  }
+  ssize_t m;
+  int errorNumber = 0;
+  Task task([&fd, &iov, &iovcnt, &m, &errorNumber] {
+    do {
+      m = readv(fd, iov, iovcnt);
+      if (m >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (m < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    if (n != 0) {
+      return n;
+    }
+    errno = errorNumber;
+    return -1;
+  }
+  return n + m;
+}
+
+ssize_t WriteFile(int fd, const iovec *iov, int iovcnt)
+{
+  size_t size = GetIOVectorSize(iov, iovcnt);
+  std::vector<iovec> iovs;
+  size_t n = 0;
+  for (;;) {
+    ssize_t m;
+    do {
+      m = pwritev2(fd, iov, iovcnt, -1, RWF_NOWAIT);
+      if (m >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (m < 0) {
+      if (errno != EWOULDBLOCK && errno != EOPNOTSUPP) {
+        return n != 0 ? static_cast<ssize_t>(n) : -1;
+      }
+      break;
+    }
+    n += m;
+    if (n == size) {
+      return n;
+    }
+    if (m == 0) {
+      break;
+    }
+    if (iovs.empty()) {
+      iovs.assign(iov, iov + iovcnt);
+    }
+    SkipIOVector(&iovs, m);
+    iov = iovs.data();
+    iovcnt = iovs.size();
+  }
+  ssize_t m;
+  int errorNumber = 0;
+  Task task([&fd, &iov, &iovcnt, &m, &errorNumber] {
+    do {
+      m = writev(fd, iov, iovcnt);
+      if (m >= 0) {
+        break;
+      }
+    } while (errno == EINTR);
+    if (m < 0) {
+      errorNumber = errno;
+    }
+  });
+  TheScheduler->awaitTask(&task);
+  if (errorNumber != 0) {
+    if (n != 0) {
+      return n;
+    }
+    errno = errorNumber;
+    return -1;
+  }
+  return n + m;
+}
+
+size_t GetIOVectorSize(const iovec *iov, int iovcnt)
+{
+  size_t size = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    size += iov[i].iov_len;
+  }
+  return size;
+}
+
+void SkipIOVector(std::vector<iovec> *iovs, size_t n)
+{
+  assert(iovs != nullptr);
+  auto it = iovs->begin();
+  while (it != iovs->end() && n >= it->iov_len) {
+    n -= it->iov_len;
+    ++it;
+  }
+  iovs->erase(iovs->begin(), it);
+  if (n != 0) {
+    iovs->front().iov_base = static_cast<char *>(iovs->front().iov_base) + n;
+    iovs->front().iov_len -= n;
+  }
+}
+
+void SetSocketBusyPoll(int fd)
+{
+  int busyPoll = TheScheduler->getSocketBusyPoll();
+  if (busyPoll != 0) {
+    static_cast<void>(setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busyPoll,
+                                 sizeof busyPoll));
+  }
+}
+
+int SyncFiles(const int *fds, unsigned int fdCount, int (*sync)(int fd))
+{
+  std::vector<Task> tasks;
+  std::vector<int> errorNumbers(fdCount, 0);
+  tasks.reserve(fdCount);
+  for (unsigned int i = 0; i < fdCount; ++i) {
+    int fd = fds[i];
+    int *errorNumber = &errorNumbers[i];
+    tasks.emplace_back([fd, errorNumber, sync] {
+      int result;
+      do {
+        result = sync(fd);
+        if (result >= 0) {
+          break;
+        }
+      } while (errno == EINTR);
+      if (result < 0) {
+        *errorNumber = errno;
+      }
+    });
+  }
+  TheScheduler->awaitTasks(tasks.data(), fdCount);
+  for (int errorNumber : errorNumbers) {
+    if (errorNumber != 0) {
+      errno = errorNumber;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+bool IOIsAwaitable(int fd)
+{
+  return TheScheduler->ioIsWatched(fd) && !TheScheduler->ioIsFile(fd) &&
+         TheScheduler->ioIsPollable(fd);
+}
+
+int AwaitTransfer(int fdin, int fdout, int *readyFD, int timeout)
+{
+  assert(readyFD != nullptr);
+  bool awaitsInput = IOIsAwaitable(fdin);
+  bool awaitsOutput = IOIsAwaitable(fdout);
+  if (!awaitsInput && !awaitsOutput) {
+    errno = EWOULDBLOCK;
+    return -1;
+  }
+  if (awaitsInput && awaitsOutput) {
+    awaitsInput = fdin != *readyFD;
+    awaitsOutput = fdout != *readyFD;
+  }
+  pollfd fds[2];
+  fds[0].fd = awaitsInput ? fdin : -1;
+  fds[0].events = POLLIN;
+  fds[1].fd = awaitsOutput ? fdout : -1;
+  fds[1].events = POLLOUT;
+  if (TheScheduler->awaitIOEvents(fds, TARA_LENGTH_OF(fds), timeout) < 0) {
+    return -1;
+  }
+  *readyFD = -1;
+  if (awaitsInput && awaitsOutput) {
+    for (const pollfd &pollFD : fds) {
+      if (pollFD.revents != 0) {
+        *readyFD = *readyFD < 0 ? pollFD.fd : -1;
+      }
+    }
+  }
+  for (const pollfd &pollFD : fds) {
+    if (pollFD.revents == POLLNVAL) {
+      errno = EBADF;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+io_uring_sqe MakeIORequest(int opcode, int fd, const void *buf, size_t buflen)
+{
+  io_uring_sqe request = {};
+  request.opcode = opcode;
+  request.fd = fd;
+  request.addr = reinterpret_cast<uintptr_t>(buf);
+  request.len = buflen < UINT32_MAX ? buflen : UINT32_MAX;
+  return request;
+}
+
+} // namespace
+
 } // namespace Tara
@@ -1,204 +1,643 @@
 #include "Scheduler.hxx"
 
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#
 #include <errno.h>
-#include <stdlib.h>
+#include <stdint.h>
 #
-#include <utility>
+#include <memory>
 #
 #ifdef USE_VALGRIND
 #include <valgrind/valgrind.h>
 #endif
 #
+#include "Atomic.hxx"
+#include "Error.hxx"
+#include "IOEvent.hxx"
 #include "Log.hxx"
 #include "RunFiber.hxx"
+#include "SchedulerGroup.hxx"
+#include "Settings.hxx"
+#include "SwitchContext.hxx"
 #include "TimerItem.hxx"
 #include "Utility.hxx"
 
 #define TARA_REGION_SIZE 65536
+#define TARA_IO_RING_SIZE 256
+#define TARA_IO_POLL_REQUEST 1
+#define TARA_IO_CANCEL_REQUEST 2
+#define TARA_IO_AWAITER_BUFFER_LENGTH 16
 
 namespace Tara {
 
 struct Fiber final
 {
   QUEUE queueItem;
+  QUEUE parkingQueueItem;
   TimerItem timerItem;
-  const Coroutine coroutine;
   unsigned char *const stack;
   const size_t stackSize;
+  void *coroutine;
+  const CoroutineType *coroutineType;
 #ifdef USE_VALGRIND
   const unsigned int stackID;
 #endif
-  jmp_buf *context;
+  void *context;
   int status;
-  int fd;
+  bool awaitsIOEvent;
+  QUEUE *waiterQueue;
+  bool awaitsIORequest;
+  int timerSlack;
+  uint64_t parkingTime;
 
-  Fiber(const Coroutine &coroutine, unsigned char *stack, size_t stackSize);
-  Fiber(Coroutine &&coroutine, unsigned char *stack, size_t stackSize);
+  Fiber(unsigned char *stack, size_t stackSize);
   ~Fiber();
 };
 
+struct IOAwaiter final
+{
+  QUEUE queueItem;
+  Fiber *fiber;
+  int fd;
+  IOEvent event;
+  short events;
+  short readyEvents;
+};
+
 namespace {
 
+const short IOEventFlags[] = {
+  [static_cast<int>(IOEvent::Readability)] = POLLIN,
+  [static_cast<int>(IOEvent::Writability)] = POLLOUT,
+  [static_cast<int>(IOEvent::Error)] = POLLERR
+};
+
 class UnwindStack final
 {};
 
-Fiber *CreateFiber(const Coroutine &coroutine);
-Fiber *CreateFiber(Coroutine &&coroutine);
-void DestroyFiber(Fiber *fiber);
+Fiber *CreateFiber(StackPool *stackPool, size_t regionSize);
+void DestroyFiber(StackPool *stackPool, Fiber *fiber);
+void SetCoroutine(Fiber *fiber, const CoroutineType &coroutineType,
+                  const void *coroutine);
+size_t GetRegionSize(const Fiber *fiber);
 void FiberStart(Scheduler *scheduler) noexcept;
+void ReclaimStack(Fiber *fiber);
+void LockSpin(unsigned int *lock);
+void UnlockSpin(unsigned int *lock);
+
+void xmadvise(void *addr, size_t length, int advice);
 
 } // namespace
 
-Scheduler::Scheduler()
-  : fiberCount_(0), context_(nullptr), status_(0), runningFiber_(nullptr),
-    async_(this)
+Scheduler::Scheduler(SchedulerGroup *group)
+  : group_(group), fiberCount_(0), context_(nullptr), runningFiber_(nullptr),
+    stackReclamationDelay_(GetSetting("TARA_STACK_RECLAIM_DELAY", 0)),
+    runSwitchBudget_(GetSetting("TARA_RUN_BUDGET_SWITCHES", 1024)),
+    runTimeBudget_(GetSetting("TARA_RUN_BUDGET_TIME", 0)), switchCount_(0),
+    runStartTime_(0), timerSlack_(GetSetting("TARA_TIMER_SLACK", 0)),
+    busyPollTime_(GetSetting("TARA_BUSY_POLL_TIME", 0)),
+    socketBusyPoll_(GetSetting("TARA_SOCKET_BUSY_POLL", 0)),
+    spinHitCount_(0), blockingWaitCount_(0),
+    stackPool_(GetSetting("TARA_STACK_POOL_LIMIT", 1024)),
+    sharedFiberCount_(0), sharedFiberQueueLock_(0), isSleeping_(0),
+    ioPoll_(GetSetting("TARA_EPOLL_EDGE_TRIGGERED", 0) != 0),
+    ioRing_(GetSetting("TARA_IO_URING", 0) != 0 ? TARA_IO_RING_SIZE : 0),
+    ioPollIsSubmitted_(false),
+    timer_(GetSetting("TARA_TIMER_WHEEL", 0) != 0), runHoldCount_(0),
+    async_(this, GetSetting("TARA_ASYNC_MIN_THREADS", 1),
+           GetSetting("TARA_ASYNC_MAX_THREADS", 0),
+           GetSetting("TARA_ASYNC_GROWTH_DELAY", 0),
+           GetSetting("TARA_ASYNC_IDLE_TIMEOUT", 10000))
 {
+  stackPool_.reserveRegions(TARA_REGION_SIZE,
+                            GetSetting("TARA_STACK_POOL_PREWARM", 0));
+  QUEUE_INIT(&parkedFiberQueue_);
   QUEUE_INIT(&readyFiberQueue_);
   QUEUE_INIT(&deadFiberQueue_);
+  QUEUE_INIT(&sharedFiberQueue_);
 }
 
-void Scheduler::callCoroutine(const Coroutine &coroutine)
+void Scheduler::callCoroutine(const CoroutineType &coroutineType,
+                              const void *coroutine, size_t stackSize)
 {
-  Fiber *fiber;
+  size_t regionSize = getRegionSize(stackSize, coroutineType);
+  Fiber *fiber = nullptr;
   if (!QUEUE_EMPTY(&deadFiberQueue_)) {
     fiber = QUEUE_DATA(QUEUE_HEAD(&deadFiberQueue_), Fiber, queueItem);
-    QUEUE_REMOVE(&fiber->queueItem);
-    const_cast<Coroutine &>(fiber->coroutine) = coroutine;
-  } else {
-    fiber = CreateFiber(coroutine);
+    if (GetRegionSize(fiber) == regionSize) {
+      QUEUE_REMOVE(&fiber->queueItem);
+    } else {
+      fiber = nullptr;
+    }
+  }
+  if (fiber == nullptr) {
+    fiber = CreateFiber(&stackPool_, regionSize);
     ++fiberCount_;
   }
+  SetCoroutine(fiber, coroutineType, coroutine);
+  fiber->timerSlack = getTimerSlack();
   QUEUE_INSERT_TAIL(&readyFiberQueue_, &fiber->queueItem);
 }
 
-void Scheduler::callCoroutine(Coroutine &&coroutine)
+void Scheduler::dispatchCoroutine(const CoroutineType &coroutineType,
+                                  const void *coroutine, size_t stackSize)
 {
-  Fiber *fiber;
-  if (!QUEUE_EMPTY(&deadFiberQueue_)) {
-    fiber = QUEUE_DATA(QUEUE_HEAD(&deadFiberQueue_), Fiber, queueItem);
+  if (group_ == nullptr) {
+    callCoroutine(coroutineType, coroutine, stackSize);
+    return;
+  }
+  Fiber *fiber = CreateFiber(&stackPool_,
+                             getRegionSize(stackSize, coroutineType));
+  SetCoroutine(fiber, coroutineType, coroutine);
+  fiber->timerSlack = getTimerSlack();
+  shareFiber(fiber);
+}
+
+Fiber *Scheduler::popSharedFiber()
+{
+  unsigned int sharedFiberCount = 0;
+  ExchangeAdd(sharedFiberCount_, sharedFiberCount);
+  if (sharedFiberCount == 0) {
+    return nullptr;
+  }
+  Fiber *fiber = nullptr;
+  LockSpin(&sharedFiberQueueLock_);
+  if (!QUEUE_EMPTY(&sharedFiberQueue_)) {
+    fiber = QUEUE_DATA(QUEUE_HEAD(&sharedFiberQueue_), Fiber, queueItem);
     QUEUE_REMOVE(&fiber->queueItem);
-    const_cast<Coroutine &>(fiber->coroutine) = std::move(coroutine);
-  } else {
-    fiber = CreateFiber(std::move(coroutine));
-    ++fiberCount_;
+    sharedFiberCount = -1;
+    ExchangeAdd(sharedFiberCount_, sharedFiberCount);
   }
-  QUEUE_INSERT_TAIL(&readyFiberQueue_, &fiber->queueItem);
+  UnlockSpin(&sharedFiberQueueLock_);
+  return fiber;
+}
+
+bool Scheduler::wakeUp()
+{
+  unsigned int isSleeping = 1;
+  if (!CompareExchange(isSleeping_, isSleeping, 0u)) {
+    return false;
+  }
+  ioPoll_.interrupt();
+  return true;
 }
 
 void Scheduler::run()
 {
   assert(runningFiber_ == nullptr);
-  if (fiberCount_ == 0) {
-    return;
-  }
+  timer_.updateTime();
   for (;;) {
-    if (!QUEUE_EMPTY(&readyFiberQueue_)) {
-      jmp_buf context;
-      if (setjmp(context) != 0) {
-        goto no_ready_fiber;
+    if (fiberCount_ == 0 && runHoldCount_ == 0) {
+      if (group_ == nullptr || !adoptSharedFiber()) {
+        break;
       }
-      context_ = &context;
-      status_ = 1;
+    }
+    if (!QUEUE_EMPTY(&readyFiberQueue_)) {
       auto fiber = QUEUE_DATA(QUEUE_HEAD(&readyFiberQueue_), Fiber, queueItem);
       QUEUE_REMOVE(&fiber->queueItem);
-      executeFiber(fiber);
+      resetRunBudget();
+      executeFiber(&context_, fiber);
     }
-no_ready_fiber:
     if (!QUEUE_EMPTY(&deadFiberQueue_)) {
       QUEUE *q = QUEUE_HEAD(&deadFiberQueue_);
       do {
         auto fiber = QUEUE_DATA(q, Fiber, queueItem);
         q = QUEUE_NEXT(q);
-        DestroyFiber(fiber);
+        DestroyFiber(&stackPool_, fiber);
         --fiberCount_;
       } while (q != &deadFiberQueue_);
       QUEUE_INIT(&deadFiberQueue_);
-      if (fiberCount_ == 0) {
-        break;
+      if (fiberCount_ == 0 && runHoldCount_ == 0) {
+        continue;
       }
     }
     {
-      QUEUE fiberQueue;
-      QUEUE_INIT(&fiberQueue);
-      while (!ioPoll_.waitForEvents(timer_.calculateTimeout(), &fiberQueue));
-      QUEUE *q;
-      QUEUE_FOREACH(q, &fiberQueue) {
-        auto fiber = QUEUE_DATA(q, Fiber, queueItem);
-        timer_.removeItem(&fiber->timerItem);
+      int timeout = QUEUE_EMPTY(&readyFiberQueue_) ? timer_.calculateTimeout()
+                                                   : 0;
+      if (stackReclamationDelay_ != 0) {
+        int reclamationTimeout = reclaimFiberStacks();
+        if (reclamationTimeout >= 0 &&
+            (timeout < 0 || reclamationTimeout < timeout)) {
+          timeout = reclamationTimeout;
+        }
       }
-      if (!QUEUE_EMPTY(&fiberQueue)) {
-        QUEUE_ADD(&readyFiberQueue_, &fiberQueue);
+      if (group_ != nullptr && timeout != 0) {
+        unsigned int isSleeping = 1;
+        Exchange(isSleeping_, isSleeping);
+        Fiber *fiber = group_->stealFiber(this);
+        if (fiber != nullptr) {
+          ++fiberCount_;
+          group_->decreaseWork();
+          QUEUE_INSERT_TAIL(&readyFiberQueue_, &fiber->queueItem);
+          timeout = 0;
+        }
+      }
+      QUEUE ioAwaiterQueue;
+      QUEUE_INIT(&ioAwaiterQueue);
+      if (timeout == 0 || busyPollTime_ == 0 ||
+          !spinForIOEvents(&timeout, &ioAwaiterQueue)) {
+        if (timeout != 0) {
+          ++blockingWaitCount_;
+        }
+        if (timeout != 0 && timer_.hasPreciseItems()) {
+          timespec preciseTimeout;
+          timeout = timer_.calculatePreciseTimeout(timeout, &preciseTimeout);
+          while (!waitForIOEvents(timeout, &ioAwaiterQueue, &preciseTimeout));
+        } else {
+          while (!waitForIOEvents(timeout, &ioAwaiterQueue, nullptr));
+        }
       }
+      timer_.updateTime();
+      if (group_ != nullptr) {
+        unsigned int isSleeping = 0;
+        Exchange(isSleeping_, isSleeping);
+      }
+      wakeIOAwaiters(&ioAwaiterQueue, false);
     }
     {
       TimerItem *buffer[1024];
       unsigned int n = timer_.removeDueItems(buffer, TARA_LENGTH_OF(buffer));
       for (int i = n - 1; i >= 0; --i) {
         auto fiber = TARA_CONTAINER_OF(buffer[i], Fiber, timerItem);
-        if (fiber->fd >= 0) {
-          ioPoll_.removeEventAwaiter(fiber->queueItem, fiber->fd);
-          fiber->fd = -1;
+        if (fiber->awaitsIOEvent) {
+          fiber->status = -ETIME;
+        } else if (fiber->waiterQueue != nullptr) {
+          QUEUE_REMOVE(&fiber->queueItem);
+          fiber->waiterQueue = nullptr;
           fiber->status = -ETIME;
+        } else if (fiber->awaitsIORequest) {
+          cancelIORequest(fiber);
+          fiber->status = -ETIME;
+          continue;
         }
         QUEUE_INSERT_HEAD(&readyFiberQueue_, &fiber->queueItem);
       }
+      timer_.runDueCallbacks();
     }
   }
 }
 
-void Scheduler::execute()
+size_t Scheduler::getRegionSize(size_t stackSize,
+                                const CoroutineType &coroutineType) const
 {
-  runningFiber_ = nullptr;
+  size_t overheadSize = sizeof(Fiber) + coroutineType.size +
+                        coroutineType.alignment + 15;
+  if (stackSize == 0) {
+    if (overheadSize <= TARA_REGION_SIZE / 2) {
+      return TARA_REGION_SIZE;
+    }
+    stackSize = TARA_REGION_SIZE / 2;
+  }
+  if (stackSize > SIZE_MAX - overheadSize) {
+    TARA_FATALITY_LOG("stack size too large: ", stackSize);
+  }
+  return stackPool_.roundRegionSize(stackSize + overheadSize);
+}
+
+void Scheduler::parkFiber(Fiber *fiber)
+{
+  assert(fiber != nullptr);
+  if (stackReclamationDelay_ == 0) {
+    return;
+  }
+  fiber->parkingTime = timer_.getTime();
+  QUEUE_INSERT_TAIL(&parkedFiberQueue_, &fiber->parkingQueueItem);
+}
+
+void Scheduler::unparkFiber(Fiber *fiber)
+{
+  assert(fiber != nullptr);
+  if (!QUEUE_EMPTY(&fiber->parkingQueueItem)) {
+    QUEUE_REMOVE(&fiber->parkingQueueItem);
+    QUEUE_INIT(&fiber->parkingQueueItem);
+  }
+}
+
+int Scheduler::reclaimFiberStacks()
+{
+  if (QUEUE_EMPTY(&parkedFiberQueue_)) {
+    return -1;
+  }
+  uint64_t now = timer_.getTime();
+  do {
+    auto fiber = QUEUE_DATA(QUEUE_HEAD(&parkedFiberQueue_), Fiber,
+                            parkingQueueItem);
+    uint64_t reclamationTime = fiber->parkingTime + stackReclamationDelay_;
+    if (reclamationTime > now) {
+      return reclamationTime - now;
+    }
+    QUEUE_REMOVE(&fiber->parkingQueueItem);
+    QUEUE_INIT(&fiber->parkingQueueItem);
+    ReclaimStack(fiber);
+  } while (!QUEUE_EMPTY(&parkedFiberQueue_));
+  return -1;
+}
+
+bool Scheduler::adoptSharedFiber()
+{
+  assert(group_ != nullptr);
+  for (;;) {
+    unsigned int isSleeping = 1;
+    Exchange(isSleeping_, isSleeping);
+    Fiber *fiber = group_->stealFiber(this);
+    if (fiber != nullptr) {
+      isSleeping = 0;
+      Exchange(isSleeping_, isSleeping);
+      ++fiberCount_;
+      group_->decreaseWork();
+      QUEUE_INSERT_TAIL(&readyFiberQueue_, &fiber->queueItem);
+      return true;
+    }
+    group_->decreaseWork();
+    QUEUE ioAwaiterQueue;
+    QUEUE_INIT(&ioAwaiterQueue);
+    while (!group_->isFinished() &&
+           !ioPoll_.waitForEvents(-1, &ioAwaiterQueue));
+    assert(QUEUE_EMPTY(&ioAwaiterQueue));
+    if (group_->isFinished()) {
+      return false;
+    }
+    timer_.updateTime();
+    group_->increaseWork();
+  }
+}
+
+void Scheduler::shareFiber(Fiber *fiber)
+{
+  assert(group_ != nullptr);
+  group_->increaseWork();
+  LockSpin(&sharedFiberQueueLock_);
+  QUEUE_INSERT_TAIL(&sharedFiberQueue_, &fiber->queueItem);
+  unsigned int sharedFiberCount = 1;
+  ExchangeAdd(sharedFiberCount_, sharedFiberCount);
+  UnlockSpin(&sharedFiberQueueLock_);
+  group_->wakeScheduler();
+}
+
+bool Scheduler::waitForIOEvents(int timeout, QUEUE *ioAwaiterQueue,
+                                const timespec *preciseTimeout)
+{
+  assert(ioAwaiterQueue != nullptr);
+  if (!ioRing_.isEnabled()) {
+    return ioPoll_.waitForEvents(timeout, ioAwaiterQueue, preciseTimeout);
+  }
+  ioPoll_.updateWatchers();
+  if (!ioPollIsSubmitted_) {
+    io_uring_sqe *submission = ioRing_.getSubmission();
+    submission->opcode = IORING_OP_POLL_ADD;
+    submission->fd = ioPoll_.getFD();
+    submission->poll32_events = POLLIN;
+    submission->user_data = TARA_IO_POLL_REQUEST;
+    ioPollIsSubmitted_ = true;
+  }
+  if (!ioRing_.waitForCompletions(timeout, preciseTimeout)) {
+    return false;
+  }
+  reapIOCompletions(ioAwaiterQueue);
+  return true;
+}
+
+void Scheduler::reapIOCompletions(QUEUE *ioAwaiterQueue)
+{
+  assert(ioAwaiterQueue != nullptr);
+  io_uring_cqe buffer[256];
+  unsigned int n;
+  do {
+    n = ioRing_.reapCompletions(buffer, TARA_LENGTH_OF(buffer));
+    for (unsigned int i = 0; i < n; ++i) {
+      const io_uring_cqe &completion = buffer[i];
+      if (completion.user_data == TARA_IO_CANCEL_REQUEST) {
+        if (completion.res < 0 && completion.res != -ENOENT &&
+            completion.res != -EALREADY) {
+          TARA_FATALITY_LOG("io_uring cancel failed: ",
+                            Error(-completion.res));
+        }
+        continue;
+      }
+      if (completion.user_data == TARA_IO_POLL_REQUEST) {
+        ioPollIsSubmitted_ = false;
+        while (!ioPoll_.waitForEvents(0, ioAwaiterQueue));
+        continue;
+      }
+      auto fiber = reinterpret_cast<Fiber *>(completion.user_data);
+      QUEUE_REMOVE(&fiber->queueItem);
+      fiber->awaitsIORequest = false;
+      if (fiber->status == -ETIME) {
+        if (completion.res >= 0) {
+          fiber->status = completion.res;
+        }
+      } else {
+        timer_.removeItem(&fiber->timerItem);
+        fiber->status = completion.res == -ECANCELED ? -EBADF
+                                                     : completion.res;
+      }
+      QUEUE_INSERT_TAIL(&readyFiberQueue_, &fiber->queueItem);
+    }
+  } while (n == TARA_LENGTH_OF(buffer));
+}
+
+void Scheduler::cancelIORequest(Fiber *fiber)
+{
+  assert(fiber != nullptr);
+  io_uring_sqe *submission = ioRing_.getSubmission();
+  submission->opcode = IORING_OP_ASYNC_CANCEL;
+  submission->addr = reinterpret_cast<uintptr_t>(fiber);
+  submission->user_data = TARA_IO_CANCEL_REQUEST;
+}
+
+bool Scheduler::spinForIOEvents(int *timeout, QUEUE *ioAwaiterQueue)
+{
+  assert(timeout != nullptr);
+  assert(ioAwaiterQueue != nullptr);
+  uint64_t spinTime = busyPollTime_;
+  if (*timeout >= 0 && spinTime > *timeout * UINT64_C(1000)) {
+    spinTime = *timeout * UINT64_C(1000);
+  }
+  if (timer_.hasPreciseItems()) {
+    timespec preciseTimeout;
+    timer_.calculatePreciseTimeout(*timeout, &preciseTimeout);
+    uint64_t preciseSpinTime = preciseTimeout.tv_sec * UINT64_C(1000000) +
+                               preciseTimeout.tv_nsec / 1000;
+    if (spinTime > preciseSpinTime) {
+      spinTime = preciseSpinTime;
+    }
+  }
+  uint64_t startTime = Timer::GetMicrosecondTime();
+  uint64_t elapsedTime;
+  for (;;) {
+    while (!waitForIOEvents(0, ioAwaiterQueue, nullptr));
+    if (!QUEUE_EMPTY(ioAwaiterQueue) || !QUEUE_EMPTY(&readyFiberQueue_)) {
+      ++spinHitCount_;
+      return true;
+    }
+    elapsedTime = Timer::GetMicrosecondTime() - startTime;
+    if (elapsedTime >= spinTime) {
+      break;
+    }
+    __asm__ __volatile__ ("pause");
+  }
+  if (*timeout >= 0) {
+    int elapsedTimeout = elapsedTime / 1000;
+    *timeout = *timeout > elapsedTimeout ? *timeout - elapsedTimeout : 0;
+  }
+  return *timeout == 0;
+}
+
+void Scheduler::wakeIOAwaiters(QUEUE *ioAwaiterQueue, bool ioIsClosed)
+{
+  assert(ioAwaiterQueue != nullptr);
+  while (!QUEUE_EMPTY(ioAwaiterQueue)) {
+    QUEUE *q = QUEUE_HEAD(ioAwaiterQueue);
+    QUEUE_REMOVE(q);
+    QUEUE_INIT(q);
+    auto ioAwaiter = QUEUE_DATA(q, IOAwaiter, queueItem);
+    ioAwaiter->readyEvents = ioIsClosed ? POLLNVAL : ioAwaiter->events;
+    Fiber *fiber = ioAwaiter->fiber;
+    if (fiber->status == 1) {
+      fiber->status = 0;
+      timer_.removeItem(&fiber->timerItem);
+      QUEUE_INSERT_TAIL(&readyFiberQueue_, &fiber->queueItem);
+    }
+  }
+}
+
+int Scheduler::awaitIOAwaiters(IOAwaiter *ioAwaiters,
+                               unsigned int ioAwaiterCount, int timeout)
+{
+  assert(runningFiber_ != nullptr);
+  assert(ioAwaiters != nullptr || ioAwaiterCount == 0);
+  for (unsigned int i = 0; i < ioAwaiterCount; ++i) {
+    if (!ioPoll_.watcherIsPollable(ioAwaiters[i].fd)) {
+      errno = EWOULDBLOCK;
+      return -1;
+    }
+  }
+  Fiber *currentFiber = runningFiber_;
+  for (unsigned int i = 0; i < ioAwaiterCount; ++i) {
+    IOAwaiter *ioAwaiter = &ioAwaiters[i];
+    ioAwaiter->fiber = currentFiber;
+    ioAwaiter->readyEvents = 0;
+    ioPoll_.addEventAwaiter(&ioAwaiter->queueItem, ioAwaiter->fd,
+                            ioAwaiter->event);
+  }
+  currentFiber->status = 1;
+  currentFiber->awaitsIOEvent = true;
+  timer_.addItem(&currentFiber->timerItem, timeout,
+                 currentFiber->timerSlack);
+  parkFiber(currentFiber);
+  executeNextFiber(&currentFiber->context);
+  unparkFiber(currentFiber);
+  currentFiber->awaitsIOEvent = false;
+  for (unsigned int i = 0; i < ioAwaiterCount; ++i) {
+    IOAwaiter *ioAwaiter = &ioAwaiters[i];
+    if (!QUEUE_EMPTY(&ioAwaiter->queueItem)) {
+      ioPoll_.removeEventAwaiter(ioAwaiter->queueItem, ioAwaiter->fd);
+    }
+  }
+  if (currentFiber->status < 0) {
+    errno = -currentFiber->status;
+    return -1;
+  }
+  return 0;
+}
+
+void Scheduler::resetRunBudget()
+{
+  switchCount_ = 0;
+  if (runTimeBudget_ != 0) {
+    runStartTime_ = Timer::GetMicrosecondTime();
+  }
+}
+
+bool Scheduler::runBudgetIsExhausted()
+{
+  if (runSwitchBudget_ != 0 && ++switchCount_ >= runSwitchBudget_) {
+    return true;
+  }
+  return runTimeBudget_ != 0 &&
+         Timer::GetMicrosecondTime() - runStartTime_ >= runTimeBudget_;
+}
+
+void Scheduler::execute(void **context)
+{
+  assert(context != nullptr);
   assert(context_ != nullptr);
-  assert(status_ != 0);
-  longjmp(*context_, status_);
+  runningFiber_ = nullptr;
+  SwitchContext(context, context_);
 }
 
-void Scheduler::executeFiber(Fiber *fiber)
+void Scheduler::executeFiber(void **context, Fiber *fiber)
 {
+  assert(context != nullptr);
   assert(fiber != nullptr);
   runningFiber_ = fiber;
   if (fiber->context == nullptr) {
-    RunFiber(FiberStart, this, fiber->stack, fiber->stackSize);
+    RunFiber(context, FiberStart, this, fiber->stack,
+             static_cast<unsigned char *>(fiber->coroutine) - fiber->stack);
+  } else {
+    SwitchContext(context, fiber->context);
   }
-  assert(fiber->status != 0);
-  longjmp(*fiber->context, fiber->status);
+}
+
+void Scheduler::executeNextFiber(void **context)
+{
+  if (QUEUE_EMPTY(&readyFiberQueue_) || runBudgetIsExhausted()) {
+    execute(context);
+  } else {
+    auto fiber = QUEUE_DATA(QUEUE_HEAD(&readyFiberQueue_), Fiber, queueItem);
+    QUEUE_REMOVE(&fiber->queueItem);
+    executeFiber(context, fiber);
+  }
+}
+
+int Scheduler::getTimerSlack() const
+{
+  return runningFiber_ == nullptr ? timerSlack_ : runningFiber_->timerSlack;
+}
+
+void Scheduler::setTimerSlack(int timerSlack)
+{
+  assert(runningFiber_ != nullptr);
+  runningFiber_->timerSlack = timerSlack >= 0 ? timerSlack : timerSlack_;
 }
 
 void Scheduler::yieldCurrentFiber()
 {
   assert(runningFiber_ != nullptr);
+  Fiber *currentFiber = runningFiber_;
   if (QUEUE_EMPTY(&readyFiberQueue_)) {
+    if (!runBudgetIsExhausted()) {
+      return;
+    }
+    QUEUE_INSERT_TAIL(&readyFiberQueue_, &currentFiber->queueItem);
+    execute(&currentFiber->context);
     return;
   }
-  jmp_buf context;
-  if (setjmp(context) != 0) {
-    return;
-  }
-  runningFiber_->context = &context;
-  runningFiber_->status = 1;
-  QUEUE_INSERT_TAIL(&readyFiberQueue_, &runningFiber_->queueItem);
-  auto fiber = QUEUE_DATA(QUEUE_HEAD(&readyFiberQueue_), Fiber, queueItem);
-  QUEUE_REMOVE(&fiber->queueItem);
-  executeFiber(fiber);
+  QUEUE_INSERT_TAIL(&readyFiberQueue_, &currentFiber->queueItem);
+  executeNextFiber(&currentFiber->context);
 }
 
 void Scheduler::sleepCurrentFiber(int duration)
 {
   assert(runningFiber_ != nullptr);
-  jmp_buf context;
-  if (setjmp(context) != 0) {
-    return;
-  }
-  runningFiber_->context = &context;
-  runningFiber_->status = 1;
-  timer_.addItem(&runningFiber_->timerItem, duration);
-  if (QUEUE_EMPTY(&readyFiberQueue_)) {
-    execute();
-  }
-  auto fiber = QUEUE_DATA(QUEUE_HEAD(&readyFiberQueue_), Fiber, queueItem);
-  QUEUE_REMOVE(&fiber->queueItem);
-  executeFiber(fiber);
+  Fiber *currentFiber = runningFiber_;
+  timer_.addItem(&currentFiber->timerItem, duration,
+                 currentFiber->timerSlack);
+  parkFiber(currentFiber);
+  executeNextFiber(&currentFiber->context);
+  unparkFiber(currentFiber);
+}
+
+void Scheduler::sleepCurrentFiber(const timespec &duration)
+{
+  assert(runningFiber_ != nullptr);
+  Fiber *currentFiber = runningFiber_;
+  timer_.addPreciseItem(&currentFiber->timerItem, duration);
+  parkFiber(currentFiber);
+  executeNextFiber(&currentFiber->context);
+  unparkFiber(currentFiber);
 }
 
 void Scheduler::exitCurrentFiber() const
@@ -213,71 +652,170 @@ void Scheduler::killCurrentFiber()
   runningFiber_->context = nullptr;
   runningFiber_->status = 0;
   QUEUE_INSERT_TAIL(&deadFiberQueue_, &runningFiber_->queueItem);
-  if (QUEUE_EMPTY(&readyFiberQueue_)) {
-    execute();
-  }
-  auto fiber = QUEUE_DATA(QUEUE_HEAD(&readyFiberQueue_), Fiber, queueItem);
-  QUEUE_REMOVE(&fiber->queueItem);
-  executeFiber(fiber);
+  void *context;
+  executeNextFiber(&context);
+  __builtin_unreachable();
 }
 
 void Scheduler::unwatchIO(int fd)
 {
-  QUEUE fiberQueue;
-  QUEUE_INIT(&fiberQueue);
-  ioPoll_.removeEventAwaiters(fd, &fiberQueue);
+  QUEUE ioAwaiterQueue;
+  QUEUE_INIT(&ioAwaiterQueue);
+  ioPoll_.removeEventAwaiters(fd, &ioAwaiterQueue);
+  wakeIOAwaiters(&ioAwaiterQueue, true);
+  const QUEUE *ioRequestQueue = ioPoll_.getRequestQueue(fd);
+  if (!QUEUE_EMPTY(ioRequestQueue)) {
+    QUEUE *q;
+    QUEUE_FOREACH(q, ioRequestQueue) {
+      cancelIORequest(QUEUE_DATA(q, Fiber, queueItem));
+    }
+    do {
+      if (ioRing_.waitForCompletions(-1)) {
+        reapIOCompletions(&ioAwaiterQueue);
+      }
+    } while (!QUEUE_EMPTY(ioRequestQueue));
+    wakeIOAwaiters(&ioAwaiterQueue, false);
+  }
   ioPoll_.destroyWatcher(fd);
-  QUEUE *q;
-  QUEUE_FOREACH(q, &fiberQueue) {
-    auto fiber = QUEUE_DATA(q, Fiber, queueItem);
-    timer_.removeItem(&fiber->timerItem);
-    fiber->status = -EBADF;
+}
+
+int Scheduler::awaitIOEvent(int fd, IOEvent ioEvent, int timeout)
+{
+  IOAwaiter ioAwaiter;
+  ioAwaiter.fd = fd;
+  ioAwaiter.event = ioEvent;
+  ioAwaiter.events = IOEventFlags[static_cast<int>(ioEvent)];
+  if (awaitIOAwaiters(&ioAwaiter, 1, timeout) < 0) {
+    return -1;
   }
-  if (!QUEUE_EMPTY(&fiberQueue)) {
-    QUEUE_ADD(&readyFiberQueue_, &fiberQueue);
+  if (ioAwaiter.readyEvents == POLLNVAL) {
+    errno = EBADF;
+    return -1;
   }
+  return 0;
 }
 
-int Scheduler::awaitIOEvent(int fd, IOEvent ioEvent, int timeout)
+int Scheduler::awaitIOEvents(pollfd *fds, nfds_t nfds, int timeout)
 {
-  assert(runningFiber_ != nullptr);
-  jmp_buf context;
-  int status = setjmp(context);
-  if (status != 0) {
-    if (status < 0) {
-      errno = -status;
-      return -1;
+  assert(fds != nullptr || nfds == 0);
+  unsigned int ioAwaiterCount = 0;
+  for (nfds_t i = 0; i < nfds; ++i) {
+    fds[i].revents = 0;
+    if (fds[i].fd >= 0) {
+      ioAwaiterCount += ((fds[i].events & POLLIN) != 0) +
+                        ((fds[i].events & POLLOUT) != 0);
     }
+  }
+  if (ioAwaiterCount == 0) {
     return 0;
   }
-  runningFiber_->context = &context;
-  runningFiber_->status = 1;
-  runningFiber_->fd = fd;
-  ioPoll_.addEventAwaiter(&runningFiber_->queueItem, fd, ioEvent);
-  timer_.addItem(&runningFiber_->timerItem, timeout);
-  if (QUEUE_EMPTY(&readyFiberQueue_)) {
-    execute();
+  IOAwaiter ioAwaiterBuffer[TARA_IO_AWAITER_BUFFER_LENGTH];
+  std::unique_ptr<IOAwaiter[]> ioAwaiterStorage;
+  IOAwaiter *ioAwaiters = ioAwaiterBuffer;
+  if (ioAwaiterCount > TARA_IO_AWAITER_BUFFER_LENGTH) {
+    ioAwaiterStorage.reset(new IOAwaiter[ioAwaiterCount]);
+    ioAwaiters = ioAwaiterStorage.get();
   }
-  auto fiber = QUEUE_DATA(QUEUE_HEAD(&readyFiberQueue_), Fiber, queueItem);
-  QUEUE_REMOVE(&fiber->queueItem);
-  executeFiber(fiber);
+  unsigned int j = 0;
+  for (nfds_t i = 0; i < nfds; ++i) {
+    if (fds[i].fd < 0) {
+      continue;
+    }
+    if ((fds[i].events & POLLIN) != 0) {
+      ioAwaiters[j].fd = fds[i].fd;
+      ioAwaiters[j].event = IOEvent::Readability;
+      ioAwaiters[j++].events = POLLIN;
+    }
+    if ((fds[i].events & POLLOUT) != 0) {
+      ioAwaiters[j].fd = fds[i].fd;
+      ioAwaiters[j].event = IOEvent::Writability;
+      ioAwaiters[j++].events = POLLOUT;
+    }
+  }
+  if (awaitIOAwaiters(ioAwaiters, ioAwaiterCount, timeout) < 0) {
+    return -1;
+  }
+  int readyCount = 0;
+  j = 0;
+  for (nfds_t i = 0; i < nfds; ++i) {
+    if (fds[i].fd < 0) {
+      continue;
+    }
+    unsigned int k = j + ((fds[i].events & POLLIN) != 0) +
+                     ((fds[i].events & POLLOUT) != 0);
+    for (; j < k; ++j) {
+      fds[i].revents |= ioAwaiters[j].readyEvents;
+    }
+    if (fds[i].revents != 0) {
+      ++readyCount;
+    }
+  }
+  return readyCount;
 }
 
-void Scheduler::suspendCurrentFiber()
+int Scheduler::awaitIORequest(const io_uring_sqe &request, int timeout)
 {
   assert(runningFiber_ != nullptr);
-  jmp_buf context;
-  if (setjmp(context) != 0) {
-    return;
+  assert(ioRing_.isEnabled());
+  Fiber *currentFiber = runningFiber_;
+  io_uring_sqe *submission = ioRing_.getSubmission();
+  *submission = request;
+  submission->user_data = reinterpret_cast<uintptr_t>(currentFiber);
+  ioPoll_.addRequest(&currentFiber->queueItem, request.fd);
+  currentFiber->status = 1;
+  currentFiber->awaitsIORequest = true;
+  timer_.addItem(&currentFiber->timerItem, timeout,
+                 currentFiber->timerSlack);
+  parkFiber(currentFiber);
+  executeNextFiber(&currentFiber->context);
+  unparkFiber(currentFiber);
+  if (currentFiber->status < 0) {
+    errno = -currentFiber->status;
+    return -1;
   }
-  runningFiber_->context = &context;
-  runningFiber_->status = 1;
-  if (QUEUE_EMPTY(&readyFiberQueue_)) {
-    execute();
+  return currentFiber->status;
+}
+
+int Scheduler::awaitZeroCopySends(int fd, int timeout)
+{
+  while (ioPoll_.reapZeroCopyCompletions(fd) < 0) {
+    if (errno != EWOULDBLOCK) {
+      return -1;
+    }
+    if (awaitIOEvent(fd, IOEvent::Error, timeout) < 0) {
+      return -1;
+    }
   }
-  auto fiber = QUEUE_DATA(QUEUE_HEAD(&readyFiberQueue_), Fiber, queueItem);
-  QUEUE_REMOVE(&fiber->queueItem);
-  executeFiber(fiber);
+  return 0;
+}
+
+void Scheduler::suspendCurrentFiber()
+{
+  assert(runningFiber_ != nullptr);
+  Fiber *currentFiber = runningFiber_;
+  parkFiber(currentFiber);
+  executeNextFiber(&currentFiber->context);
+  unparkFiber(currentFiber);
+}
+
+int Scheduler::suspendCurrentFiber(QUEUE *waiterQueue, int timeout)
+{
+  assert(runningFiber_ != nullptr);
+  assert(waiterQueue != nullptr);
+  Fiber *currentFiber = runningFiber_;
+  currentFiber->status = 1;
+  currentFiber->waiterQueue = waiterQueue;
+  QUEUE_INSERT_TAIL(waiterQueue, &currentFiber->queueItem);
+  timer_.addItem(&currentFiber->timerItem, timeout,
+                 currentFiber->timerSlack);
+  parkFiber(currentFiber);
+  executeNextFiber(&currentFiber->context);
+  unparkFiber(currentFiber);
+  if (currentFiber->status < 0) {
+    errno = -currentFiber->status;
+    return -1;
+  }
+  return 0;
 }
 
 void Scheduler::resumeFiber(Fiber *fiber)
@@ -288,28 +826,34 @@ void Scheduler::resumeFiber(Fiber *fiber)
   QUEUE_INSERT_TAIL(&readyFiberQueue_, &fiber->queueItem);
 }
 
-Fiber::Fiber(const Coroutine &coroutine, unsigned char *stack, size_t stackSize)
-  : coroutine(coroutine), stack(stack), stackSize(stackSize),
-#ifdef USE_VALGRIND
-    stackID(VALGRIND_STACK_REGISTER(stack, stack + stackSize)),
-#endif
-    context(nullptr), status(0), fd(-1)
+bool Scheduler::resumeFiber(QUEUE *waiterQueue)
 {
-  assert(this->coroutine != nullptr);
-  assert(this->stack != nullptr);
-  assert(this->stackSize != 0);
+  assert(runningFiber_ != nullptr);
+  assert(waiterQueue != nullptr);
+  if (QUEUE_EMPTY(waiterQueue)) {
+    return false;
+  }
+  auto fiber = QUEUE_DATA(QUEUE_HEAD(waiterQueue), Fiber, queueItem);
+  assert(fiber->waiterQueue == waiterQueue);
+  QUEUE_REMOVE(&fiber->queueItem);
+  timer_.removeItem(&fiber->timerItem);
+  fiber->waiterQueue = nullptr;
+  QUEUE_INSERT_TAIL(&readyFiberQueue_, &fiber->queueItem);
+  return true;
 }
 
-Fiber::Fiber(Coroutine &&coroutine, unsigned char *stack, size_t stackSize)
-  : coroutine(std::move(coroutine)), stack(stack), stackSize(stackSize),
+Fiber::Fiber(unsigned char *stack, size_t stackSize)
+  : stack(stack), stackSize(stackSize),
 #ifdef USE_VALGRIND
     stackID(VALGRIND_STACK_REGISTER(stack, stack + stackSize)),
 #endif
-    context(nullptr), status(0), fd(-1)
+    coroutine(nullptr), coroutineType(nullptr), context(nullptr), status(0),
+    awaitsIOEvent(false), waiterQueue(nullptr), awaitsIORequest(false),
+    timerSlack(0)
 {
-  assert(this->coroutine != nullptr);
   assert(this->stack != nullptr);
   assert(this->stackSize != 0);
+  QUEUE_INIT(&this->parkingQueueItem);
 }
 
 Fiber::~Fiber()
@@ -321,40 +865,50 @@ Fiber::~Fiber()
 
 namespace {
 
-Fiber *CreateFiber(const Coroutine &coroutine)
+Fiber *CreateFiber(StackPool *stackPool, size_t regionSize)
 {
-  auto region = static_cast<unsigned char *>(malloc(TARA_REGION_SIZE));
-  if (region == nullptr) {
-    assert(TARA_REGION_SIZE != 0);
-    TARA_FATALITY_LOG("malloc failed");
-  }
-  auto fiber = reinterpret_cast<Fiber *>(region + TARA_REGION_SIZE) - 1;
+  assert(stackPool != nullptr);
+  unsigned char *region = stackPool->allocateRegion(regionSize);
+  auto fiber = reinterpret_cast<Fiber *>(region + regionSize) - 1;
   unsigned char *stack = region;
-  size_t stackSize = TARA_REGION_SIZE - sizeof *fiber;
-  static_cast<void>(new (fiber) Fiber(coroutine, stack, stackSize));
+  size_t stackSize = (regionSize - sizeof *fiber) & ~size_t(15);
+  static_cast<void>(new (fiber) Fiber(stack, stackSize));
   return fiber;
 }
 
-Fiber *CreateFiber(Coroutine &&coroutine)
+void DestroyFiber(StackPool *stackPool, Fiber *fiber)
+{
+  assert(stackPool != nullptr);
+  assert(fiber != nullptr);
+  unsigned char *region = fiber->stack;
+  size_t regionSize = GetRegionSize(fiber);
+  fiber->~Fiber();
+  stackPool->freeRegion(region, regionSize);
+}
+
+void SetCoroutine(Fiber *fiber, const CoroutineType &coroutineType,
+                  const void *coroutine)
 {
-  auto region = static_cast<unsigned char *>(malloc(TARA_REGION_SIZE));
-  if (region == nullptr) {
-    assert(TARA_REGION_SIZE != 0);
-    TARA_FATALITY_LOG("malloc failed");
+  assert(fiber != nullptr);
+  assert(fiber->context == nullptr);
+  uintptr_t alignmentMask = (coroutineType.alignment > 16 ?
+                             coroutineType.alignment : 16) - 1;
+  if (coroutineType.size + alignmentMask >= fiber->stackSize) {
+    TARA_FATALITY_LOG("coroutine too large for its stack: ",
+                      coroutineType.size);
   }
-  auto fiber = reinterpret_cast<Fiber *>(region + TARA_REGION_SIZE) - 1;
-  unsigned char *stack = region;
-  size_t stackSize = TARA_REGION_SIZE - sizeof *fiber;
-  static_cast<void>(new (fiber) Fiber(std::move(coroutine), stack, stackSize));
-  return fiber;
+  uintptr_t address = reinterpret_cast<uintptr_t>(fiber->stack +
+                                                  fiber->stackSize);
+  address = (address - coroutineType.size) & ~alignmentMask;
+  fiber->coroutine = reinterpret_cast<void *>(address);
+  fiber->coroutineType = &coroutineType;
+  coroutineType.construct(fiber->coroutine, coroutine);
 }
 
-void DestroyFiber(Fiber *fiber)
+size_t GetRegionSize(const Fiber *fiber)
 {
   assert(fiber != nullptr);
-  fiber->~Fiber();
-  auto region = reinterpret_cast<unsigned char *>(fiber + 1) - TARA_REGION_SIZE;
-  free(region);
+  return reinterpret_cast<const unsigned char *>(fiber + 1) - fiber->stack;
 }
 
 void FiberStart(Scheduler *scheduler) noexcept
@@ -362,11 +916,50 @@ void FiberStart(Scheduler *scheduler) noexcept
   assert(scheduler != nullptr);
   Fiber *fiber = scheduler->getCurrentFiber();
   try {
-    fiber->coroutine();
+    fiber->coroutineType->call(fiber->coroutine);
   } catch (const UnwindStack &) {}
+  fiber->coroutineType->destroy(fiber->coroutine);
   scheduler->killCurrentFiber();
 }
 
+void ReclaimStack(Fiber *fiber)
+{
+  assert(fiber != nullptr);
+  assert(fiber->context != nullptr);
+  uintptr_t pageMask = sysconf(_SC_PAGE_SIZE) - 1;
+  auto stackEnd = reinterpret_cast<unsigned char *>
+                  (reinterpret_cast<uintptr_t>(fiber->context) & ~pageMask);
+  if (stackEnd > fiber->stack) {
+    xmadvise(fiber->stack, stackEnd - fiber->stack, MADV_DONTNEED);
+  }
+}
+
+void LockSpin(unsigned int *lock)
+{
+  assert(lock != nullptr);
+  for (;;) {
+    unsigned int isLocked = 0;
+    if (CompareExchange(*lock, isLocked, 1u)) {
+      break;
+    }
+    __asm__ __volatile__ ("pause");
+  }
+}
+
+void UnlockSpin(unsigned int *lock)
+{
+  assert(lock != nullptr);
+  unsigned int isLocked = 0;
+  Exchange(*lock, isLocked);
+}
+
+void xmadvise(void *addr, size_t length, int advice)
+{
+  if (madvise(addr, length, advice) < 0) {
+    TARA_FATALITY_LOG("madvise failed: ", Error(errno));
+  }
+}
+
 } // namespace
 
 } // namespace Tara
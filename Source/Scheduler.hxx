@@ -1,19 +1,26 @@
 #pragma once
 
+#include <poll.h>
+#
 #include <assert.h>
-#include <setjmp.h>
+#include <stdint.h>
 #
 #include "libuv/queue.h"
 #
 #include "Async.hxx"
 #include "Coroutine.hxx"
 #include "IOPoll.hxx"
+#include "IORing.hxx"
+#include "StackPool.hxx"
 #include "Timer.hxx"
 
 namespace Tara {
 
 struct Fiber;
+struct IOAwaiter;
 enum class IOEvent;
+class SchedulerGroup;
+struct TimerItem;
 
 class Scheduler final
 {
@@ -21,39 +28,118 @@ class Scheduler final
   void operator=(const Scheduler &other) = delete;
 
 public:
-  Scheduler();
+  explicit Scheduler(SchedulerGroup *group = nullptr);
 
   Fiber *getCurrentFiber() const { assert(runningFiber_ != nullptr);
                                    return runningFiber_; }
   bool ioIsWatched(int fd) const { return ioPoll_.watcherExists(fd); }
-  void watchIO(int fd) { ioPoll_.createWatcher(fd); }
+  bool ioIsReady(int fd, IOEvent ioEvent) const
+  { return ioPoll_.eventIsReady(fd, ioEvent); }
+  bool ioIsFile(int fd) const { return ioPoll_.watcherIsFile(fd); }
+  bool ioIsPollable(int fd) const { return ioPoll_.watcherIsPollable(fd); }
+  bool usesIORing() const { return ioRing_.isEnabled(); }
+  int getSocketBusyPoll() const { return socketBusyPoll_; }
+  unsigned long getSpinHitCount() const { return spinHitCount_; }
+  unsigned long getBlockingWaitCount() const { return blockingWaitCount_; }
+  void watchIO(int fd, bool isFile = false)
+  { ioPoll_.createWatcher(fd, isFile); }
+  bool enableZeroCopy(int fd) { return ioPoll_.enableZeroCopy(fd); }
+  void addZeroCopySend(int fd) { ioPoll_.addZeroCopySend(fd); }
   void awaitTask(const Task *task) { async_.awaitTask(task); }
+  void awaitTasks(const Task *tasks, unsigned int taskCount)
+  { async_.awaitTasks(tasks, taskCount); }
+  void interrupt() { ioPoll_.interrupt(); }
+  void addTimerItem(TimerItem *item, int duration, int slack)
+  { timer_.addItem(item, duration, slack); }
+  void removeTimerItem(TimerItem *item) { timer_.removeItem(item); }
+  void holdRun() { ++runHoldCount_; }
+  void releaseRun() { --runHoldCount_; }
+
+  template <typename COROUTINE>
+  void callCoroutine(COROUTINE &&coroutine, size_t stackSize = 0)
+  { callCoroutine(CoroutineTypeOf<COROUTINE>::Value, &coroutine, stackSize); }
+
+  template <typename COROUTINE>
+  void dispatchCoroutine(COROUTINE &&coroutine, size_t stackSize = 0)
+  {
+    dispatchCoroutine(CoroutineTypeOf<COROUTINE>::Value, &coroutine,
+                      stackSize);
+  }
 
-  void callCoroutine(const Coroutine &coroutine);
-  void callCoroutine(Coroutine &&coroutine);
+  void callCoroutine(const CoroutineType &coroutineType, const void *coroutine,
+                     size_t stackSize);
+  void dispatchCoroutine(const CoroutineType &coroutineType,
+                         const void *coroutine, size_t stackSize);
+  Fiber *popSharedFiber();
+  bool wakeUp();
   void run();
+  int getTimerSlack() const;
+  void setTimerSlack(int timerSlack);
   void yieldCurrentFiber();
   void sleepCurrentFiber(int duration);
+  void sleepCurrentFiber(const timespec &duration);
   [[noreturn]] void exitCurrentFiber() const;
   [[noreturn]] void killCurrentFiber();
   void unwatchIO(int fd);
   int awaitIOEvent(int fd, IOEvent ioEvent, int timeout);
+  int awaitIOEvents(pollfd *fds, nfds_t nfds, int timeout);
+  int awaitZeroCopySends(int fd, int timeout);
+  int awaitIORequest(const io_uring_sqe &request, int timeout);
   void suspendCurrentFiber();
+  int suspendCurrentFiber(QUEUE *waiterQueue, int timeout);
   void resumeFiber(Fiber *fiber);
+  bool resumeFiber(QUEUE *waiterQueue);
 
 private:
+  SchedulerGroup *const group_;
   unsigned int fiberCount_;
-  jmp_buf *context_;
-  int status_;
+  void *context_;
   Fiber *runningFiber_;
+  const uint64_t stackReclamationDelay_;
+  const unsigned int runSwitchBudget_;
+  const uint64_t runTimeBudget_;
+  unsigned int switchCount_;
+  uint64_t runStartTime_;
+  const int timerSlack_;
+  const uint64_t busyPollTime_;
+  const int socketBusyPoll_;
+  unsigned long spinHitCount_;
+  unsigned long blockingWaitCount_;
+  QUEUE parkedFiberQueue_;
+  StackPool stackPool_;
   QUEUE readyFiberQueue_;
   QUEUE deadFiberQueue_;
+  QUEUE sharedFiberQueue_;
+  unsigned int sharedFiberCount_;
+  unsigned int sharedFiberQueueLock_;
+  unsigned int isSleeping_;
   IOPoll ioPoll_;
+  IORing ioRing_;
+  bool ioPollIsSubmitted_;
   Timer timer_;
+  unsigned int runHoldCount_;
   Async async_;
 
-  [[noreturn]] void execute();
-  [[noreturn]] void executeFiber(Fiber *fiber);
+  size_t getRegionSize(size_t stackSize,
+                       const CoroutineType &coroutineType) const;
+  void parkFiber(Fiber *fiber);
+  void unparkFiber(Fiber *fiber);
+  int reclaimFiberStacks();
+  bool adoptSharedFiber();
+  void shareFiber(Fiber *fiber);
+  bool waitForIOEvents(int timeout, QUEUE *ioAwaiterQueue,
+                       const timespec *preciseTimeout);
+  void reapIOCompletions(QUEUE *ioAwaiterQueue);
+  void cancelIORequest(Fiber *fiber);
+  bool spinForIOEvents(int *timeout, QUEUE *ioAwaiterQueue);
+  void wakeIOAwaiters(QUEUE *ioAwaiterQueue, bool ioIsClosed);
+  int awaitIOAwaiters(IOAwaiter *ioAwaiters, unsigned int ioAwaiterCount,
+                      int timeout);
+  void resetRunBudget();
+  bool runBudgetIsExhausted();
+  void execute(void **context);
+  void executeFiber(void **context, Fiber *fiber);
+  void executeNextFiber(void **context);
 };
 
 } // namespace Tara
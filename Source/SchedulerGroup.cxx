@@ -0,0 +1,145 @@
+#include "SchedulerGroup.hxx"
+
+#include <assert.h>
+#include <errno.h>
+#
+#include "Atomic.hxx"
+#include "Error.hxx"
+#include "Log.hxx"
+#include "Scheduler.hxx"
+
+namespace Tara {
+
+extern thread_local Scheduler *TheScheduler;
+
+namespace {
+
+void xthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                    void *(*start_routine)(void *), void *arg);
+void xthread_join(pthread_t thread, void **retval);
+
+} // namespace
+
+SchedulerGroup::SchedulerGroup(unsigned int schedulerCount)
+  : workCount_(schedulerCount), isFinished_(0)
+{
+  assert(schedulerCount != 0);
+  schedulers_.reserve(schedulerCount);
+  for (unsigned int i = 0; i < schedulerCount; ++i) {
+    schedulers_.push_back(new Scheduler(this));
+  }
+}
+
+SchedulerGroup::~SchedulerGroup()
+{
+  for (int i = schedulers_.size() - 1; i >= 0; --i) {
+    delete schedulers_[i];
+  }
+}
+
+void SchedulerGroup::run()
+{
+  assert(threads_.empty());
+  threads_.resize(schedulers_.size() - 1);
+  for (int i = 0; i < threads_.size(); ++i) {
+    xthread_create(&threads_[i], nullptr, Worker, schedulers_[i + 1]);
+  }
+  Worker(schedulers_[0]);
+  for (int i = 0; i < threads_.size(); ++i) {
+    xthread_join(threads_[i], nullptr);
+  }
+  threads_.clear();
+}
+
+bool SchedulerGroup::isFinished()
+{
+  unsigned int isFinished = 0;
+  ExchangeAdd(isFinished_, isFinished);
+  return isFinished != 0;
+}
+
+void SchedulerGroup::increaseWork()
+{
+  unsigned int delta = 1;
+  ExchangeAdd(workCount_, delta);
+}
+
+void SchedulerGroup::decreaseWork()
+{
+  unsigned int delta = -1;
+  ExchangeAdd(workCount_, delta);
+  if (delta != 1) {
+    return;
+  }
+  unsigned int isFinished = 1;
+  Exchange(isFinished_, isFinished);
+  for (Scheduler *scheduler : schedulers_) {
+    scheduler->interrupt();
+  }
+}
+
+void SchedulerGroup::wakeScheduler()
+{
+  for (Scheduler *scheduler : schedulers_) {
+    if (scheduler->wakeUp()) {
+      break;
+    }
+  }
+}
+
+Fiber *SchedulerGroup::stealFiber(Scheduler *thief)
+{
+  assert(thief != nullptr);
+  Fiber *fiber = thief->popSharedFiber();
+  if (fiber != nullptr) {
+    return fiber;
+  }
+  for (Scheduler *victim : schedulers_) {
+    if (victim == thief) {
+      continue;
+    }
+    fiber = victim->popSharedFiber();
+    if (fiber != nullptr) {
+      return fiber;
+    }
+  }
+  return nullptr;
+}
+
+void *SchedulerGroup::Worker(void *scheduler)
+{
+  assert(scheduler != nullptr);
+  TheScheduler = static_cast<Scheduler *>(scheduler);
+  TheScheduler->run();
+  TheScheduler = nullptr;
+  return nullptr;
+}
+
+namespace {
+
+void xthread_create(pthread_t *thread, const pthread_attr_t *attr,
+                    void *(*start_routine)(void *), void *arg)
+{
+  int errorNumber;
+  do {
+    errorNumber = pthread_create(thread, attr, start_routine, arg);
+    if (errorNumber == 0) {
+      break;
+    }
+  } while (errorNumber == EAGAIN);
+  if (errorNumber != 0) {
+    TARA_FATALITY_LOG("pthread_create failed: ", Error(errorNumber));
+  }
+}
+
+void xthread_join(pthread_t thread, void **retval)
+{
+  int errorNumber = pthread_join(thread, retval);
+  if (errorNumber != 0) {
+    TARA_FATALITY_LOG("pthread_join failed: ", Error(errorNumber));
+  }
+}
+
+} // namespace
+
+} // namespace Tara
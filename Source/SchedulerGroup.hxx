@@ -0,0 +1,40 @@
+#pragma once
+
+#include <pthread.h>
+#
+#include <vector>
+
+namespace Tara {
+
+struct Fiber;
+class Scheduler;
+
+class SchedulerGroup final
+{
+  SchedulerGroup(const SchedulerGroup &other) = delete;
+  void operator=(const SchedulerGroup &other) = delete;
+
+public:
+  explicit SchedulerGroup(unsigned int schedulerCount);
+  ~SchedulerGroup();
+
+  Scheduler *getScheduler(unsigned int index) const
+  { return schedulers_[index]; }
+
+  void run();
+  bool isFinished();
+  void increaseWork();
+  void decreaseWork();
+  void wakeScheduler();
+  Fiber *stealFiber(Scheduler *thief);
+
+private:
+  static void *Worker(void *scheduler);
+
+  std::vector<Scheduler *> schedulers_;
+  std::vector<pthread_t> threads_;
+  unsigned int workCount_;
+  unsigned int isFinished_;
+};
+
+} // namespace Tara
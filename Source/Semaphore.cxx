@@ -0,0 +1,58 @@
+#include "Semaphore.hxx"
+
+#include <assert.h>
+#
+#include "libuv/queue.h"
+#
+#include "TheScheduler.hxx"
+
+namespace Tara {
+
+Semaphore::Semaphore(unsigned int count)
+  : scheduler_(nullptr), count_(count)
+{
+  QUEUE_INIT(&waiterQueue_);
+}
+
+Semaphore::~Semaphore()
+{
+  assert(QUEUE_EMPTY(&waiterQueue_));
+}
+
+int Semaphore::wait(int timeout)
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (count_ != 0) {
+    --count_;
+    return 0;
+  }
+  return TheScheduler->suspendCurrentFiber(&waiterQueue_, timeout);
+}
+
+bool Semaphore::tryWait()
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (count_ == 0) {
+    return false;
+  }
+  --count_;
+  return true;
+}
+
+void Semaphore::post(unsigned int count)
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (count == 0) {
+    return;
+  }
+  if (!QUEUE_EMPTY(&waiterQueue_)) {
+    while (TheScheduler->resumeFiber(&waiterQueue_)) {
+      if (--count == 0) {
+        return;
+      }
+    }
+  }
+  count_ += count;
+}
+
+} // namespace Tara
@@ -0,0 +1,28 @@
+#include "Settings.hxx"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#
+#include "Log.hxx"
+
+namespace Tara {
+
+unsigned long GetSetting(const char *name, unsigned long defaultValue)
+{
+  assert(name != nullptr);
+  const char *value = getenv(name);
+  if (value == nullptr || *value == '\0') {
+    return defaultValue;
+  }
+  char *end;
+  errno = 0;
+  unsigned long number = strtoul(value, &end, 0);
+  if (errno != 0 || *end != '\0') {
+    TARA_WARNING_LOG("invalid setting: ", name, "=", value);
+    return defaultValue;
+  }
+  return number;
+}
+
+} // namespace Tara
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace Tara {
+
+unsigned long GetSetting(const char *name, unsigned long defaultValue);
+
+} // namespace Tara
@@ -0,0 +1,182 @@
+#include "StackPool.hxx"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#
+#include <assert.h>
+#include <errno.h>
+#
+#include "Error.hxx"
+#include "Log.hxx"
+#include "Utility.hxx"
+
+namespace Tara {
+
+namespace {
+
+unsigned char *&GetRegionLink(unsigned char *region, size_t regionSize);
+size_t NextPageAlignedSize(size_t size);
+
+long xsysconf(int name);
+void *xmmap(void *addr, size_t length, int prot, int flags, int fd,
+            off_t offset);
+void xmunmap(void *addr, size_t length);
+void xmprotect(void *addr, size_t len, int prot);
+
+} // namespace
+
+StackPool::StackPool(unsigned int maxFreeRegionCount)
+  : minRegionSize_(NextPageAlignedSize(8192)),
+    guardSize_(NextPageAlignedSize(1)),
+    maxFreeRegionCount_(maxFreeRegionCount)
+{
+  for (FreeList &freeList : freeLists_) {
+    freeList.lastRegion = nullptr;
+    freeList.regionCount = 0;
+  }
+}
+
+StackPool::~StackPool()
+{
+  for (int i = 0; i < TARA_LENGTH_OF(freeLists_); ++i) {
+    trimFreeRegions(minRegionSize_ << i, 0);
+  }
+}
+
+size_t StackPool::roundRegionSize(size_t regionSize) const
+{
+  size_t maxRegionSize = minRegionSize_ << (TARA_LENGTH_OF(freeLists_) - 1);
+  if (regionSize > maxRegionSize) {
+    TARA_FATALITY_LOG("stack region too large: ", regionSize, " > ",
+                      maxRegionSize);
+  }
+  size_t roundedRegionSize = minRegionSize_;
+  while (roundedRegionSize < regionSize) {
+    roundedRegionSize <<= 1;
+  }
+  return roundedRegionSize;
+}
+
+unsigned char *StackPool::allocateRegion(size_t regionSize)
+{
+  FreeList *freeList = getFreeList(regionSize);
+  if (freeList->lastRegion == nullptr) {
+    return mapRegion(regionSize);
+  }
+  unsigned char *region = freeList->lastRegion;
+  freeList->lastRegion = GetRegionLink(region, regionSize);
+  --freeList->regionCount;
+  return region;
+}
+
+void StackPool::freeRegion(unsigned char *region, size_t regionSize)
+{
+  assert(region != nullptr);
+  FreeList *freeList = getFreeList(regionSize);
+  GetRegionLink(region, regionSize) = freeList->lastRegion;
+  freeList->lastRegion = region;
+  ++freeList->regionCount;
+  if (freeList->regionCount > maxFreeRegionCount_) {
+    trimFreeRegions(regionSize, maxFreeRegionCount_ / 2);
+  }
+}
+
+void StackPool::reserveRegions(size_t regionSize, unsigned int regionCount)
+{
+  FreeList *freeList = getFreeList(regionSize);
+  while (freeList->regionCount < regionCount) {
+    unsigned char *region = mapRegion(regionSize);
+    GetRegionLink(region, regionSize) = freeList->lastRegion;
+    freeList->lastRegion = region;
+    ++freeList->regionCount;
+  }
+}
+
+StackPool::FreeList *StackPool::getFreeList(size_t regionSize)
+{
+  assert(regionSize == roundRegionSize(regionSize));
+  int i = 0;
+  while ((minRegionSize_ << i) < regionSize) {
+    ++i;
+  }
+  return &freeLists_[i];
+}
+
+unsigned char *StackPool::mapRegion(size_t regionSize)
+{
+  auto base = static_cast<unsigned char *>
+              (xmmap(nullptr, guardSize_ + regionSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0));
+  xmprotect(base, guardSize_, PROT_NONE);
+  return base + guardSize_;
+}
+
+void StackPool::unmapRegion(unsigned char *region, size_t regionSize)
+{
+  assert(region != nullptr);
+  xmunmap(region - guardSize_, guardSize_ + regionSize);
+}
+
+void StackPool::trimFreeRegions(size_t regionSize, unsigned int freeRegionCount)
+{
+  FreeList *freeList = getFreeList(regionSize);
+  while (freeList->regionCount > freeRegionCount) {
+    unsigned char *region = freeList->lastRegion;
+    freeList->lastRegion = GetRegionLink(region, regionSize);
+    --freeList->regionCount;
+    unmapRegion(region, regionSize);
+  }
+}
+
+namespace {
+
+unsigned char *&GetRegionLink(unsigned char *region, size_t regionSize)
+{
+  assert(region != nullptr);
+  return *(reinterpret_cast<unsigned char **>(region + regionSize) - 1);
+}
+
+size_t NextPageAlignedSize(size_t size)
+{
+  --size;
+  size |= xsysconf(_SC_PAGE_SIZE) - 1;
+  ++size;
+  return size;
+}
+
+long xsysconf(int name)
+{
+  long result = sysconf(name);
+  if (result < 0) {
+    TARA_FATALITY_LOG("sysconf failed: ", Error(errno));
+  }
+  return result;
+}
+
+void *xmmap(void *addr, size_t length, int prot, int flags, int fd,
+            off_t offset)
+{
+  void *result = mmap(addr, length, prot, flags, fd, offset);
+  if (result == MAP_FAILED) {
+    TARA_FATALITY_LOG("mmap failed: ", Error(errno));
+  }
+  return result;
+}
+
+void xmunmap(void *addr, size_t length)
+{
+  if (munmap(addr, length) < 0) {
+    TARA_FATALITY_LOG("munmap failed: ", Error(errno));
+  }
+}
+
+void xmprotect(void *addr, size_t len, int prot)
+{
+  if (mprotect(addr, len, prot) < 0) {
+    TARA_FATALITY_LOG("mprotect failed: ", Error(errno));
+  }
+}
+
+} // namespace
+
+} // namespace Tara
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace Tara {
+
+class StackPool final
+{
+  StackPool(const StackPool &other) = delete;
+  void operator=(const StackPool &other) = delete;
+
+public:
+  explicit StackPool(unsigned int maxFreeRegionCount);
+  ~StackPool();
+
+  size_t roundRegionSize(size_t regionSize) const;
+  unsigned char *allocateRegion(size_t regionSize);
+  void freeRegion(unsigned char *region, size_t regionSize);
+  void reserveRegions(size_t regionSize, unsigned int regionCount);
+
+private:
+  struct FreeList final
+  {
+    unsigned char *lastRegion;
+    unsigned int regionCount;
+  };
+
+  const size_t minRegionSize_;
+  const size_t guardSize_;
+  const unsigned int maxFreeRegionCount_;
+  FreeList freeLists_[11];
+
+  FreeList *getFreeList(size_t regionSize);
+  unsigned char *mapRegion(size_t regionSize);
+  void unmapRegion(unsigned char *region, size_t regionSize);
+  void trimFreeRegions(size_t regionSize, unsigned int freeRegionCount);
+};
+
+} // namespace Tara
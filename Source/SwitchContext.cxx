@@ -0,0 +1,67 @@
+__asm__ (".globl TaraSwitchContext");
+
+#if defined __i386__
+
+// param1: 4(%esp): context
+// param2: 8(%esp): nextContext
+
+__asm__ (" \
+TaraSwitchContext:      \
+\n\tmovl 4(%esp), %eax  \
+\n\tmovl 8(%esp), %edx  \
+\n\tpushl %ebp          \
+\n\tpushl %ebx          \
+\n\tpushl %esi          \
+\n\tpushl %edi          \
+\n\tsubl $8, %esp       \
+\n\tfnstcw 4(%esp)      "
+#if defined __SSE__
+"\n\tstmxcsr (%esp)     "
+#endif
+"\n\tmovl %esp, (%eax)  \
+\n\tmovl %edx, %esp     "
+#if defined __SSE__
+"\n\tldmxcsr (%esp)     "
+#endif
+"\n\tfldcw 4(%esp)      \
+\n\taddl $8, %esp       \
+\n\tpopl %edi           \
+\n\tpopl %esi           \
+\n\tpopl %ebx           \
+\n\tpopl %ebp           \
+\n\tret                 \
+");
+
+#elif defined __x86_64__
+
+// param1: %rdi: context
+// param2: %rsi: nextContext
+
+__asm__ (" \
+TaraSwitchContext:      \
+\n\tpushq %rbp          \
+\n\tpushq %rbx          \
+\n\tpushq %r12          \
+\n\tpushq %r13          \
+\n\tpushq %r14          \
+\n\tpushq %r15          \
+\n\tsubq $8, %rsp       \
+\n\tstmxcsr (%rsp)      \
+\n\tfnstcw 4(%rsp)      \
+\n\tmovq %rsp, (%rdi)   \
+\n\tmovq %rsi, %rsp     \
+\n\tldmxcsr (%rsp)      \
+\n\tfldcw 4(%rsp)       \
+\n\taddq $8, %rsp       \
+\n\tpopq %r15           \
+\n\tpopq %r14           \
+\n\tpopq %r13           \
+\n\tpopq %r12           \
+\n\tpopq %rbx           \
+\n\tpopq %rbp           \
+\n\tretq                \
+");
+
+#else
+#error architecture not supported
+#endif
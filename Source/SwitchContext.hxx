@@ -0,0 +1,13 @@
+#pragma once
+
+#define SwitchContext TaraSwitchContext
+
+namespace Tara {
+
+extern "C" {
+
+void TaraSwitchContext(void **context, void *nextContext);
+
+} // extern "C"
+
+} // namespace Tara
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Log.hxx"
+#include "Scheduler.hxx"
+
+#define CHECK_THE_SCHEDULER              \
+  do {                                   \
+    if (TheScheduler == nullptr) {       \
+      TARA_FATALITY_LOG("No scheduler"); \
+    }                                    \
+  } while (false)
+
+#define CHECK_THE_OWNER(OWNER)                                 \
+  do {                                                         \
+    CHECK_THE_SCHEDULER;                                       \
+    if ((OWNER) == nullptr) {                                  \
+      (OWNER) = TheScheduler;                                  \
+    } else if ((OWNER) != TheScheduler) {                      \
+      TARA_FATALITY_LOG("Object used by a foreign scheduler"); \
+    }                                                          \
+  } while (false)
+
+namespace Tara {
+
+extern thread_local Scheduler *const TheScheduler;
+
+} // namespace Tara
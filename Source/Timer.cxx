@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
 #include <time.h>
 #
 #include "Error.hxx"
@@ -9,32 +10,118 @@
 #include "TimerItem.hxx"
 #include "Utility.hxx"
 
+#define TARA_WHEEL_ROOT_BITS 8
+#define TARA_WHEEL_LEVEL_BITS 6
+#define TARA_WHEEL_LEVEL_COUNT 5
+#define TARA_WHEEL_ROOT_SIZE (1 << TARA_WHEEL_ROOT_BITS)
+#define TARA_WHEEL_LEVEL_SIZE (1 << TARA_WHEEL_LEVEL_BITS)
+
 namespace Tara {
 
 namespace {
 
-uint64_t GetTime(void);
+unsigned int GetLevelShift(int level);
+unsigned int GetLevelSlotIndex(int level, uint64_t time);
+int FindNextSlot(const uint64_t *slotMasks, unsigned int slotCount,
+                 unsigned int slotIndex);
+unsigned int RemoveDueHeapItems(heap *itemHeap, uint64_t now,
+                                TimerItem **buffer, unsigned int bufferLength);
 
 void xclock_gettime(clockid_t clock_id, timespec *tp);
 int heap_compare(const heap_node* a, const heap_node* b);
 
 } // namespace
 
-Timer::Timer()
+uint64_t Timer::GetTime()
+{
+  timespec time;
+  xclock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+  return time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+uint64_t Timer::GetMicrosecondTime()
+{
+  timespec time;
+  xclock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+uint64_t Timer::GetNanosecondTime()
+{
+  timespec time;
+  xclock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * UINT64_C(1000000000) + time.tv_nsec;
+}
+
+Timer::Timer(bool usesWheel)
+  : usesWheel_(usesWheel), time_(GetTime()), wheelTime_(time_),
+    wheelItemCount_(0)
 {
   heap_init(&itemHeap_);
+  heap_init(&preciseItemHeap_);
+  for (unsigned int i = 0; i < TARA_TIMER_WHEEL_SLOT_COUNT; ++i) {
+    QUEUE_INIT(&wheelSlots_[i]);
+  }
+  for (unsigned int i = 0; i < TARA_LENGTH_OF(wheelSlotMasks_); ++i) {
+    wheelSlotMasks_[i] = 0;
+  }
+  QUEUE_INIT(&dueItemQueue_);
+  QUEUE_INIT(&dueCallbackQueue_);
 }
 
-void Timer::addItem(TimerItem *item, int duration)
+void Timer::addItem(TimerItem *item, int duration, int slack)
 {
   assert(item != nullptr);
-  item->dueTime = duration >= 0 ? GetTime() + duration : UINT64_MAX;
+  item->isPrecise = false;
+  if (duration < 0) {
+    item->dueTime = UINT64_MAX;
+    return;
+  }
+  item->dueTime = time_ + duration;
+  if (slack > 0) {
+    uint64_t granularity = UINT64_C(1) <<
+                           (31 - __builtin_clz(unsigned(slack) + 1u));
+    item->dueTime = (item->dueTime + slack) & ~(granularity - 1);
+  }
+  if (usesWheel_) {
+    if (wheelItemCount_ == 0 && wheelTime_ < time_) {
+      wheelTime_ = time_;
+    }
+    addWheelItem(item);
+    return;
+  }
   heap_insert(&itemHeap_, &item->heapNode, heap_compare);
 }
 
+void Timer::addPreciseItem(TimerItem *item, const timespec &duration)
+{
+  assert(item != nullptr);
+  assert(duration.tv_sec >= 0);
+  item->isPrecise = true;
+  item->dueTime = GetNanosecondTime() +
+                  duration.tv_sec * UINT64_C(1000000000) + duration.tv_nsec;
+  heap_insert(&preciseItemHeap_, &item->heapNode, heap_compare);
+}
+
 void Timer::removeItem(TimerItem *item)
 {
   assert(item != nullptr);
+  if (item->dueTime == UINT64_MAX) {
+    return;
+  }
+  if (item->isDue) {
+    QUEUE_REMOVE(&item->queueItem);
+    item->isDue = false;
+    return;
+  }
+  if (item->isPrecise) {
+    heap_remove(&preciseItemHeap_, &item->heapNode, heap_compare);
+    return;
+  }
+  if (usesWheel_) {
+    removeWheelItem(item);
+    return;
+  }
   heap_remove(&itemHeap_, &item->heapNode, heap_compare);
 }
 
@@ -45,51 +132,275 @@ unsigned int Timer::removeDueItems(TimerItem **buffer,
     return 0;
   }
   assert(buffer != nullptr);
-  heap_node *itemHeapNode = heap_min(&itemHeap_);
-  if (itemHeapNode == nullptr) {
-    return 0;
+  unsigned int i = 0;
+  if (usesWheel_) {
+    if (wheelItemCount_ != 0) {
+      advanceWheel(time_);
+    }
+    while (!QUEUE_EMPTY(&dueItemQueue_) && i < bufferLength) {
+      auto item = QUEUE_DATA(QUEUE_HEAD(&dueItemQueue_), TimerItem,
+                             queueItem);
+      QUEUE_REMOVE(&item->queueItem);
+      buffer[i++] = item;
+    }
+  } else {
+    i = RemoveDueHeapItems(&itemHeap_, time_, buffer, bufferLength);
   }
-  uint64_t now = GetTime();
-  int i = 0;
-  for (;;) {
-    auto item = TARA_CONTAINER_OF(itemHeapNode, TimerItem, heapNode);
-    if (item->dueTime > now) {
-      break;
+  if (i < bufferLength && hasPreciseItems()) {
+    i += RemoveDueHeapItems(&preciseItemHeap_, GetNanosecondTime(),
+                            buffer + i, bufferLength - i);
+  }
+  return divertDueCallbacks(buffer, i);
+}
+
+int Timer::calculateTimeout()
+{
+  uint64_t dueTime;
+  if (usesWheel_) {
+    if (!QUEUE_EMPTY(&dueItemQueue_)) {
+      return 0;
     }
-    heap_remove(&itemHeap_, &item->heapNode, heap_compare);
-    buffer[i++] = item;
-    if (i == bufferLength) {
-      break;
+    if (wheelItemCount_ == 0) {
+      return -1;
     }
-    itemHeapNode = heap_min(&itemHeap_);
+    dueTime = calculateWheelDueTime();
+  } else {
+    heap_node *itemHeapNode = heap_min(&itemHeap_);
     if (itemHeapNode == nullptr) {
-      break;
+      return -1;
+    }
+    dueTime = TARA_CONTAINER_OF(itemHeapNode, TimerItem, heapNode)->dueTime;
+  }
+  if (dueTime <= time_) {
+    return 0;
+  }
+  return dueTime - time_ < INT_MAX ? dueTime - time_ : INT_MAX;
+}
+
+int Timer::calculatePreciseTimeout(int timeout,
+                                   timespec *preciseTimeout) const
+{
+  assert(preciseTimeout != nullptr);
+  heap_node *itemHeapNode = heap_min(&preciseItemHeap_);
+  assert(itemHeapNode != nullptr);
+  uint64_t dueTime = TARA_CONTAINER_OF(itemHeapNode, TimerItem,
+                                       heapNode)->dueTime;
+  uint64_t now = GetNanosecondTime();
+  uint64_t duration = dueTime > now ? dueTime - now : 0;
+  if (timeout >= 0 && timeout * UINT64_C(1000000) < duration) {
+    duration = timeout * UINT64_C(1000000);
+  }
+  preciseTimeout->tv_sec = duration / 1000000000;
+  preciseTimeout->tv_nsec = duration % 1000000000;
+  duration = (duration + 999999) / 1000000;
+  return duration < INT_MAX ? duration : INT_MAX;
+}
+
+void Timer::runDueCallbacks()
+{
+  while (!QUEUE_EMPTY(&dueCallbackQueue_)) {
+    auto item = QUEUE_DATA(QUEUE_HEAD(&dueCallbackQueue_), TimerItem,
+                           queueItem);
+    QUEUE_REMOVE(&item->queueItem);
+    item->isDue = false;
+    item->callback(item);
+  }
+}
+
+unsigned int Timer::divertDueCallbacks(TimerItem **buffer, unsigned int n)
+{
+  unsigned int i = 0;
+  for (unsigned int j = 0; j < n; ++j) {
+    TimerItem *item = buffer[j];
+    if (item->callback == nullptr) {
+      buffer[i++] = item;
+    } else {
+      item->isDue = true;
+      QUEUE_INSERT_TAIL(&dueCallbackQueue_, &item->queueItem);
     }
   }
   return i;
 }
 
-int Timer::calculateTimeout()
+void Timer::addWheelItem(TimerItem *item)
 {
-  heap_node *itemHeapNode = heap_min(&itemHeap_);
-  if (itemHeapNode == nullptr) {
-    return -1;
+  if (item->dueTime < wheelTime_) {
+    item->slotIndex = TARA_TIMER_WHEEL_SLOT_COUNT;
+    QUEUE_INSERT_TAIL(&dueItemQueue_, &item->queueItem);
+    return;
   }
-  auto item = TARA_CONTAINER_OF(itemHeapNode, TimerItem, heapNode);
-  if (item->dueTime == UINT64_MAX) {
-    return -1;
+  uint64_t delay = item->dueTime - wheelTime_;
+  unsigned int slotIndex;
+  if (delay < TARA_WHEEL_ROOT_SIZE) {
+    slotIndex = GetLevelSlotIndex(0, item->dueTime);
+  } else {
+    int level = 1;
+    while (level < TARA_WHEEL_LEVEL_COUNT - 1 &&
+           delay >> GetLevelShift(level + 1) != 0) {
+      ++level;
+    }
+    uint64_t dueTime = item->dueTime;
+    if (delay >> GetLevelShift(level + 1) != 0) {
+      dueTime = wheelTime_ + (UINT64_C(1) << GetLevelShift(level + 1)) - 1;
+    }
+    slotIndex = TARA_WHEEL_ROOT_SIZE + (level - 1) * TARA_WHEEL_LEVEL_SIZE +
+                GetLevelSlotIndex(level, dueTime);
+  }
+  item->slotIndex = slotIndex;
+  QUEUE_INSERT_TAIL(&wheelSlots_[slotIndex], &item->queueItem);
+  wheelSlotMasks_[slotIndex / 64] |= UINT64_C(1) << slotIndex % 64;
+  ++wheelItemCount_;
+}
+
+void Timer::removeWheelItem(TimerItem *item)
+{
+  QUEUE_REMOVE(&item->queueItem);
+  unsigned int slotIndex = item->slotIndex;
+  if (slotIndex == TARA_TIMER_WHEEL_SLOT_COUNT) {
+    return;
+  }
+  --wheelItemCount_;
+  if (QUEUE_EMPTY(&wheelSlots_[slotIndex])) {
+    wheelSlotMasks_[slotIndex / 64] &= ~(UINT64_C(1) << slotIndex % 64);
+  }
+}
+
+void Timer::advanceWheel(uint64_t now)
+{
+  while (wheelTime_ <= now) {
+    if (wheelItemCount_ == 0) {
+      wheelTime_ = now + 1;
+      return;
+    }
+    unsigned int slotIndex = GetLevelSlotIndex(0, wheelTime_);
+    if (slotIndex == 0) {
+      cascadeWheel();
+    }
+    QUEUE *slot = &wheelSlots_[slotIndex];
+    while (!QUEUE_EMPTY(slot)) {
+      auto item = QUEUE_DATA(QUEUE_HEAD(slot), TimerItem, queueItem);
+      QUEUE_REMOVE(&item->queueItem);
+      item->slotIndex = TARA_TIMER_WHEEL_SLOT_COUNT;
+      QUEUE_INSERT_TAIL(&dueItemQueue_, &item->queueItem);
+      --wheelItemCount_;
+    }
+    wheelSlotMasks_[slotIndex / 64] &= ~(UINT64_C(1) << slotIndex % 64);
+    ++wheelTime_;
+    if (FindNextSlot(wheelSlotMasks_, TARA_WHEEL_ROOT_SIZE, 0) < 0) {
+      uint64_t rootMask = TARA_WHEEL_ROOT_SIZE - 1;
+      uint64_t nextTime = (wheelTime_ + rootMask) & ~rootMask;
+      wheelTime_ = nextTime <= now ? nextTime : now + 1;
+    }
   }
-  uint64_t now = GetTime();
-  return item->dueTime > now ? item->dueTime - now : 0;
+}
+
+void Timer::cascadeWheel()
+{
+  for (int level = 1; level < TARA_WHEEL_LEVEL_COUNT; ++level) {
+    unsigned int levelSlotIndex = GetLevelSlotIndex(level, wheelTime_);
+    unsigned int slotIndex = TARA_WHEEL_ROOT_SIZE +
+                             (level - 1) * TARA_WHEEL_LEVEL_SIZE +
+                             levelSlotIndex;
+    QUEUE itemQueue;
+    QUEUE_INIT(&itemQueue);
+    if (!QUEUE_EMPTY(&wheelSlots_[slotIndex])) {
+      QUEUE_ADD(&itemQueue, &wheelSlots_[slotIndex]);
+      QUEUE_INIT(&wheelSlots_[slotIndex]);
+    }
+    wheelSlotMasks_[slotIndex / 64] &= ~(UINT64_C(1) << slotIndex % 64);
+    while (!QUEUE_EMPTY(&itemQueue)) {
+      auto item = QUEUE_DATA(QUEUE_HEAD(&itemQueue), TimerItem, queueItem);
+      QUEUE_REMOVE(&item->queueItem);
+      --wheelItemCount_;
+      addWheelItem(item);
+    }
+    if (levelSlotIndex != 0) {
+      break;
+    }
+  }
+}
+
+uint64_t Timer::calculateWheelDueTime() const
+{
+  uint64_t dueTime = UINT64_MAX;
+  int distance = FindNextSlot(wheelSlotMasks_, TARA_WHEEL_ROOT_SIZE,
+                              GetLevelSlotIndex(0, wheelTime_));
+  if (distance >= 0) {
+    dueTime = wheelTime_ + distance;
+  }
+  for (int level = 1; level < TARA_WHEEL_LEVEL_COUNT; ++level) {
+    unsigned int shift = GetLevelShift(level);
+    const uint64_t *slotMask = &wheelSlotMasks_[TARA_WHEEL_ROOT_SIZE / 64 +
+                                                level - 1];
+    if (*slotMask == 0) {
+      continue;
+    }
+    unsigned int skip = (wheelTime_ & ((UINT64_C(1) << shift) - 1)) != 0;
+    distance = FindNextSlot(slotMask, TARA_WHEEL_LEVEL_SIZE,
+                            (GetLevelSlotIndex(level, wheelTime_) + skip) %
+                            TARA_WHEEL_LEVEL_SIZE) + skip;
+    uint64_t cascadeTime = ((wheelTime_ >> shift) + distance) << shift;
+    if (cascadeTime < dueTime) {
+      dueTime = cascadeTime;
+    }
+  }
+  return dueTime;
 }
 
 namespace {
 
-uint64_t GetTime(void)
+unsigned int GetLevelShift(int level)
 {
-  timespec time;
-  xclock_gettime(CLOCK_MONOTONIC_COARSE, &time);
-  return time.tv_sec * 1000 + time.tv_nsec / 1000000;
+  return level == 0 ? 0 : TARA_WHEEL_ROOT_BITS +
+                          (level - 1) * TARA_WHEEL_LEVEL_BITS;
+}
+
+unsigned int GetLevelSlotIndex(int level, uint64_t time)
+{
+  return (time >> GetLevelShift(level)) &
+         ((level == 0 ? TARA_WHEEL_ROOT_SIZE : TARA_WHEEL_LEVEL_SIZE) - 1);
+}
+
+int FindNextSlot(const uint64_t *slotMasks, unsigned int slotCount,
+                 unsigned int slotIndex)
+{
+  assert(slotCount % 64 == 0);
+  for (unsigned int i = 0; i < slotCount; i += 64 - (slotIndex + i) % 64) {
+    unsigned int j = (slotIndex + i) % slotCount;
+    uint64_t slotMask = slotMasks[j / 64] >> j % 64;
+    if (slotMask != 0) {
+      return i + __builtin_ctzll(slotMask);
+    }
+  }
+  return -1;
+}
+
+unsigned int RemoveDueHeapItems(heap *itemHeap, uint64_t now,
+                                TimerItem **buffer, unsigned int bufferLength)
+{
+  assert(itemHeap != nullptr);
+  assert(buffer != nullptr);
+  heap_node *itemHeapNode = heap_min(itemHeap);
+  if (itemHeapNode == nullptr) {
+    return 0;
+  }
+  unsigned int i = 0;
+  for (;;) {
+    auto item = TARA_CONTAINER_OF(itemHeapNode, TimerItem, heapNode);
+    if (item->dueTime > now) {
+      break;
+    }
+    heap_remove(itemHeap, &item->heapNode, heap_compare);
+    buffer[i++] = item;
+    if (i == bufferLength) {
+      break;
+    }
+    itemHeapNode = heap_min(itemHeap);
+    if (itemHeapNode == nullptr) {
+      break;
+    }
+  }
+  return i;
 }
 
 void xclock_gettime(clockid_t clock_id, timespec *tp)
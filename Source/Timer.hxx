@@ -1,6 +1,12 @@
 #pragma once
 
+#include <stdint.h>
+#include <time.h>
+#
 #include "libuv/heap-inl.h"
+#include "libuv/queue.h"
+
+#define TARA_TIMER_WHEEL_SLOT_COUNT (256 + 4 * 64)
 
 namespace Tara {
 
@@ -12,15 +18,43 @@ class Timer final
   void operator=(const Timer &other) = delete;
 
 public:
-  Timer();
+  static uint64_t GetTime();
+  static uint64_t GetMicrosecondTime();
+  static uint64_t GetNanosecondTime();
+
+  explicit Timer(bool usesWheel = false);
+
+  uint64_t getTime() const { return time_; }
+  void updateTime() { time_ = GetTime(); }
+  bool hasPreciseItems() const
+  { return heap_min(&preciseItemHeap_) != nullptr; }
 
-  void addItem(TimerItem *item, int duration);
+  void addItem(TimerItem *item, int duration, int slack = 0);
+  void addPreciseItem(TimerItem *item, const timespec &duration);
   void removeItem(TimerItem *item);
   unsigned int removeDueItems(TimerItem **buffer, unsigned int bufferLength);
   int calculateTimeout();
+  int calculatePreciseTimeout(int timeout, timespec *preciseTimeout) const;
+  void runDueCallbacks();
 
 private:
+  const bool usesWheel_;
+  uint64_t time_;
   heap itemHeap_;
+  heap preciseItemHeap_;
+  uint64_t wheelTime_;
+  unsigned int wheelItemCount_;
+  QUEUE wheelSlots_[TARA_TIMER_WHEEL_SLOT_COUNT];
+  uint64_t wheelSlotMasks_[TARA_TIMER_WHEEL_SLOT_COUNT / 64];
+  QUEUE dueItemQueue_;
+  QUEUE dueCallbackQueue_;
+
+  unsigned int divertDueCallbacks(TimerItem **buffer, unsigned int n);
+  void addWheelItem(TimerItem *item);
+  void removeWheelItem(TimerItem *item);
+  void advanceWheel(uint64_t now);
+  void cascadeWheel();
+  uint64_t calculateWheelDueTime() const;
 };
 
 } // namespace Tara
@@ -0,0 +1,209 @@
+#include "TimerHandle.hxx"
+
+#include <assert.h>
+#include <errno.h>
+#
+#include "TheScheduler.hxx"
+#include "TimerItem.hxx"
+#include "Utility.hxx"
+
+namespace Tara {
+
+struct CallbackTimer final
+{
+  TimerItem timerItem;
+  Coroutine callback;
+  const int interval;
+  const int slack;
+  const bool usesFiber;
+  unsigned int referenceCount;
+  bool isActive;
+  bool isRunning;
+  bool isDetached;
+  bool holdsRun;
+
+  CallbackTimer(Coroutine &&callback, int interval, int slack,
+                bool usesFiber);
+};
+
+namespace {
+
+class CallbackRun final
+{
+  void operator=(const CallbackRun &other) = delete;
+
+public:
+  explicit CallbackRun(CallbackTimer *timer) : timer_(timer) {}
+
+  CallbackRun(CallbackRun &&other)
+    : timer_(other.timer_)
+  { other.timer_ = nullptr; }
+
+  ~CallbackRun();
+
+  void operator()();
+
+private:
+  CallbackTimer *timer_;
+};
+
+TimerHandle StartCallbackTimer(int delay, int interval, Coroutine &&callback,
+                               bool usesFiber);
+void RunCallbackTimer(TimerItem *timerItem);
+void RearmCallbackTimer(CallbackTimer *timer);
+void UpdateRunHold(CallbackTimer *timer);
+void ReleaseCallbackTimer(CallbackTimer *timer);
+
+} // namespace
+
+TimerHandle::~TimerHandle()
+{
+  detach();
+}
+
+bool TimerHandle::isActive() const
+{
+  return timer_ != nullptr && timer_->isActive;
+}
+
+void TimerHandle::cancel()
+{
+  if (timer_ == nullptr || !timer_->isActive) {
+    return;
+  }
+  CHECK_THE_SCHEDULER;
+  timer_->isActive = false;
+  UpdateRunHold(timer_);
+  if (!timer_->isRunning) {
+    TheScheduler->removeTimerItem(&timer_->timerItem);
+    ReleaseCallbackTimer(timer_);
+  }
+}
+
+void TimerHandle::detach()
+{
+  if (timer_ == nullptr) {
+    return;
+  }
+  timer_->isDetached = true;
+  UpdateRunHold(timer_);
+  ReleaseCallbackTimer(timer_);
+  timer_ = nullptr;
+}
+
+TimerHandle After(int delay, Coroutine callback, bool usesFiber)
+{
+  return StartCallbackTimer(delay, -1, std::move(callback), usesFiber);
+}
+
+TimerHandle Every(int interval, Coroutine callback, bool usesFiber)
+{
+  if (interval <= 0) {
+    errno = EINVAL;
+    return TimerHandle();
+  }
+  return StartCallbackTimer(interval, interval, std::move(callback),
+                            usesFiber);
+}
+
+CallbackTimer::CallbackTimer(Coroutine &&callback, int interval, int slack,
+                             bool usesFiber)
+  : callback(std::move(callback)), interval(interval), slack(slack),
+    usesFiber(usesFiber), referenceCount(1), isActive(false),
+    isRunning(false), isDetached(false), holdsRun(false)
+{
+  timerItem.callback = RunCallbackTimer;
+}
+
+namespace {
+
+CallbackRun::~CallbackRun()
+{
+  if (timer_ == nullptr) {
+    return;
+  }
+  if (timer_->isRunning) {
+    timer_->isRunning = false;
+    timer_->isActive = false;
+    UpdateRunHold(timer_);
+  }
+  ReleaseCallbackTimer(timer_);
+}
+
+void CallbackRun::operator()()
+{
+  timer_->callback();
+  timer_->isRunning = false;
+  RearmCallbackTimer(timer_);
+}
+
+TimerHandle StartCallbackTimer(int delay, int interval, Coroutine &&callback,
+                               bool usesFiber)
+{
+  CHECK_THE_SCHEDULER;
+  if (delay < 0 || callback == nullptr) {
+    errno = EINVAL;
+    return TimerHandle();
+  }
+  auto timer = new CallbackTimer(std::move(callback), interval,
+                                 TheScheduler->getTimerSlack(), usesFiber);
+  TheScheduler->addTimerItem(&timer->timerItem, delay, timer->slack);
+  timer->isActive = true;
+  UpdateRunHold(timer);
+  ++timer->referenceCount;
+  return TimerHandle(timer);
+}
+
+void RunCallbackTimer(TimerItem *timerItem)
+{
+  auto timer = TARA_CONTAINER_OF(timerItem, CallbackTimer, timerItem);
+  if (timer->interval < 0) {
+    timer->isActive = false;
+    UpdateRunHold(timer);
+  }
+  if (timer->usesFiber) {
+    timer->isRunning = true;
+    TheScheduler->callCoroutine(CallbackRun(timer));
+    return;
+  }
+  RearmCallbackTimer(timer);
+  timer->callback();
+  ReleaseCallbackTimer(timer);
+}
+
+void RearmCallbackTimer(CallbackTimer *timer)
+{
+  if (timer->interval < 0 || !timer->isActive) {
+    return;
+  }
+  TheScheduler->addTimerItem(&timer->timerItem, timer->interval,
+                             timer->slack);
+  ++timer->referenceCount;
+}
+
+void UpdateRunHold(CallbackTimer *timer)
+{
+  bool holdsRun = timer->isActive &&
+                  (timer->interval < 0 || !timer->isDetached);
+  if (holdsRun == timer->holdsRun) {
+    return;
+  }
+  timer->holdsRun = holdsRun;
+  if (holdsRun) {
+    TheScheduler->holdRun();
+  } else {
+    TheScheduler->releaseRun();
+  }
+}
+
+void ReleaseCallbackTimer(CallbackTimer *timer)
+{
+  assert(timer->referenceCount != 0);
+  if (--timer->referenceCount == 0) {
+    delete timer;
+  }
+}
+
+} // namespace
+
+} // namespace Tara
@@ -3,13 +3,23 @@
 #include <stdint.h>
 #
 #include "libuv/heap-inl.h"
+#include "libuv/queue.h"
 
 namespace Tara {
 
 struct TimerItem final
 {
-  heap_node heapNode;
+  union {
+    heap_node heapNode;
+    QUEUE queueItem;
+  };
   uint64_t dueTime;
+  unsigned int slotIndex;
+  bool isPrecise;
+  bool isDue;
+  void (*callback)(TimerItem *item);
+
+  TimerItem() : isDue(false), callback(nullptr) {}
 };
 
 } // namespace Tara
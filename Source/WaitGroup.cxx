@@ -0,0 +1,50 @@
+#include "WaitGroup.hxx"
+
+#include <assert.h>
+#
+#include "libuv/queue.h"
+#
+#include "Log.hxx"
+#include "TheScheduler.hxx"
+
+namespace Tara {
+
+WaitGroup::WaitGroup()
+  : scheduler_(nullptr), count_(0)
+{
+  QUEUE_INIT(&waiterQueue_);
+}
+
+WaitGroup::~WaitGroup()
+{
+  assert(QUEUE_EMPTY(&waiterQueue_));
+}
+
+void WaitGroup::add(unsigned int count)
+{
+  CHECK_THE_OWNER(scheduler_);
+  count_ += count;
+}
+
+void WaitGroup::done()
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (count_ == 0) {
+    TARA_FATALITY_LOG("WaitGroup::done() called more times than added");
+  }
+  if (--count_ != 0 || QUEUE_EMPTY(&waiterQueue_)) {
+    return;
+  }
+  while (TheScheduler->resumeFiber(&waiterQueue_)) {}
+}
+
+int WaitGroup::wait(int timeout)
+{
+  CHECK_THE_OWNER(scheduler_);
+  if (count_ == 0) {
+    return 0;
+  }
+  return TheScheduler->suspendCurrentFiber(&waiterQueue_, timeout);
+}
+
+} // namespace Tara